@@ -48,6 +48,8 @@ static void backend_destroy(struct wlr_backend *backend) {
 	wl_list_for_each_safe(fb, fb_tmp, &drm->fbs, link) {
 		drm_fb_destroy(fb);
 	}
+	hash_table_finish(&drm->fbs_by_buffer);
+	hash_table_finish(&drm->page_flips);
 
 	wl_list_remove(&drm->display_destroy.link);
 	wl_list_remove(&drm->session_destroy.link);
@@ -108,6 +110,12 @@ bool wlr_backend_is_drm(struct wlr_backend *b) {
 	return b->impl == &backend_impl;
 }
 
+void wlr_drm_backend_get_fb_stats(struct wlr_backend *backend,
+		struct wlr_drm_fb_stats *stats) {
+	struct wlr_drm_backend *drm = get_drm_backend_from_backend(backend);
+	*stats = drm->fb_stats;
+}
+
 static void handle_session_active(struct wl_listener *listener, void *data) {
 	struct wlr_drm_backend *drm =
 		wl_container_of(listener, drm, session_active);
@@ -192,7 +200,9 @@ struct wlr_backend *wlr_drm_backend_create(struct wl_display *display,
 
 	drm->session = session;
 	wl_list_init(&drm->fbs);
+	hash_table_init(&drm->fbs_by_buffer);
 	wl_list_init(&drm->outputs);
+	hash_table_init(&drm->page_flips);
 
 	drm->dev = dev;
 	drm->fd = dev->fd;
@@ -372,6 +372,26 @@ static bool drm_crtc_commit(struct wlr_drm_connector *conn,
 	return ok;
 }
 
+/**
+ * Record that the connector waits for a page-flip event on the given CRTC, or
+ * on no CRTC if zero.
+ */
+static void drm_connector_set_pending_page_flip(struct wlr_drm_connector *conn,
+		uint32_t crtc_id) {
+	struct wlr_drm_backend *drm = conn->backend;
+
+	if (conn->pending_page_flip_crtc != 0 &&
+			hash_table_get(&drm->page_flips,
+				conn->pending_page_flip_crtc) == conn) {
+		hash_table_remove(&drm->page_flips, conn->pending_page_flip_crtc);
+	}
+
+	if (crtc_id != 0 && !hash_table_set(&drm->page_flips, crtc_id, conn)) {
+		wlr_drm_conn_log(conn, WLR_ERROR, "Allocation failed");
+	}
+	conn->pending_page_flip_crtc = crtc_id;
+}
+
 static bool drm_crtc_page_flip(struct wlr_drm_connector *conn,
 		const struct wlr_output_state *state) {
 	struct wlr_drm_crtc *crtc = conn->crtc;
@@ -393,7 +413,7 @@ static bool drm_crtc_page_flip(struct wlr_drm_connector *conn,
 		return false;
 	}
 
-	conn->pending_page_flip_crtc = crtc->id;
+	drm_connector_set_pending_page_flip(conn, crtc->id);
 
 	// wlr_output's API guarantees that submitting a buffer will schedule a
 	// frame event. However the DRM backend will also schedule a frame event
@@ -1011,7 +1031,7 @@ static void drm_connector_destroy_output(struct wlr_output *output) {
 	conn->desired_enabled = false;
 	conn->desired_mode = NULL;
 	conn->possible_crtcs = 0;
-	conn->pending_page_flip_crtc = 0;
+	drm_connector_set_pending_page_flip(conn, 0);
 
 	struct wlr_drm_mode *mode, *mode_tmp;
 	wl_list_for_each_safe(mode, mode_tmp, &conn->output.modes, wlr_mode.link) {
@@ -1528,20 +1548,13 @@ static int mhz_to_nsec(int mhz) {
 static void page_flip_handler(int fd, unsigned seq,
 		unsigned tv_sec, unsigned tv_usec, unsigned crtc_id, void *data) {
 	struct wlr_drm_backend *drm = data;
-	bool found = false;
-	struct wlr_drm_connector *conn;
-	wl_list_for_each(conn, &drm->outputs, link) {
-		if (conn->pending_page_flip_crtc == crtc_id) {
-			found = true;
-			break;
-		}
-	}
-	if (!found) {
+	struct wlr_drm_connector *conn = hash_table_get(&drm->page_flips, crtc_id);
+	if (conn == NULL) {
 		wlr_log(WLR_DEBUG, "Unexpected page-flip event for CRTC %u", crtc_id);
 		return;
 	}
 
-	conn->pending_page_flip_crtc = 0;
+	drm_connector_set_pending_page_flip(conn, 0);
 
 	if (conn->state != WLR_DRM_CONN_CONNECTED || conn->crtc == NULL) {
 		wlr_drm_conn_log(conn, WLR_DEBUG,
@@ -1660,6 +1673,7 @@ void destroy_drm_connector(struct wlr_drm_connector *conn) {
 	disconnect_drm_connector(conn);
 
 	drmModeFreeCrtc(conn->old_crtc);
+	drm_connector_set_pending_page_flip(conn, 0);
 	wl_list_remove(&conn->link);
 	free(conn);
 }
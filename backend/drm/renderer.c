@@ -96,7 +96,7 @@ bool init_drm_surface(struct wlr_drm_surface *surf,
 	surf->swapchain = NULL;
 
 	surf->swapchain = wlr_swapchain_create(renderer->allocator,
-		width, height, drm_format, (void *)(unsigned long)plane->id);
+		width, height, drm_format, 0, (void *)(unsigned long)plane->id);
 	if (surf->swapchain == NULL) {
 		wlr_log(WLR_ERROR, "Failed to create swapchain");
 		memset(surf, 0, sizeof(*surf));
@@ -390,6 +390,7 @@ static struct gbm_bo *get_bo_for_dmabuf(struct gbm_device *gbm,
 static void drm_fb_handle_wlr_buf_destroy(struct wl_listener *listener,
 		void *data) {
 	struct wlr_drm_fb *fb = wl_container_of(listener, fb, wlr_buf_destroy);
+	fb->backend->fb_stats.evictions++;
 	drm_fb_destroy(fb);
 }
 
@@ -438,6 +439,12 @@ static struct wlr_drm_fb *drm_fb_create(struct wlr_drm_backend *drm,
 	}
 	fb->backend = drm;
 
+	if (!hash_table_set(&drm->fbs_by_buffer, (uintptr_t)buf, fb)) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		free(fb);
+		return NULL;
+	}
+
 	if(drm->is_eglstreams) {
 		// EGLStreams do not use FBs directly to renderer.
 		// Though fake FB is needed for modesetting.
@@ -502,11 +509,13 @@ error_get_fb_for_bo:
 	gbm_bo_destroy(fb->bo);
 error_get_dmabuf:
 error_create_dumb_fb:
+	hash_table_remove(&drm->fbs_by_buffer, (uintptr_t)buf);
 	free(fb);
 	return NULL;
 }
 
 void drm_fb_destroy(struct wlr_drm_fb *fb) {
+	hash_table_remove(&fb->backend->fbs_by_buffer, (uintptr_t)fb->wlr_buf);
 	wl_list_remove(&fb->link);
 	wl_list_remove(&fb->wlr_buf_destroy.link);
 
@@ -536,19 +545,16 @@ void drm_fb_destroy(struct wlr_drm_fb *fb) {
 
 static struct wlr_drm_fb *drm_fb_get(struct wlr_drm_backend *drm,
 		struct wlr_buffer *local_buf) {
-	struct wlr_drm_fb *fb;
-	wl_list_for_each(fb, &drm->fbs, link) {
-		if (fb->wlr_buf == local_buf) {
-			return fb;
-		}
-	}
-	return NULL;
+	return hash_table_get(&drm->fbs_by_buffer, (uintptr_t)local_buf);
 }
 
 bool drm_fb_import(struct wlr_drm_fb **fb_ptr, struct wlr_drm_backend *drm,
 		struct wlr_buffer *buf, const struct wlr_drm_format_set *formats) {
 	struct wlr_drm_fb *fb = drm_fb_get(drm, buf);
-	if (!fb) {
+	if (fb) {
+		drm->fb_stats.hits++;
+	} else {
+		drm->fb_stats.misses++;
 		fb = drm_fb_create(drm, buf, formats);
 		if (!fb) {
 			return false;
@@ -118,6 +118,23 @@ static void handle_renderer_destroy(struct wl_listener *listener, void *data) {
 	backend_destroy(&backend->backend);
 }
 
+static int64_t parse_vblank_jitter_env(void) {
+	const char *jitter_str = getenv("WLR_HEADLESS_VBLANK_JITTER");
+	if (jitter_str == NULL) {
+		return 0;
+	}
+
+	char *end;
+	long jitter = strtol(jitter_str, &end, 10);
+	if (*end || jitter < 0) {
+		wlr_log(WLR_ERROR, "WLR_HEADLESS_VBLANK_JITTER specified with "
+			"invalid integer, ignoring");
+		return 0;
+	}
+
+	return (int64_t)jitter * 1000;
+}
+
 static bool backend_init(struct wlr_headless_backend *backend,
 		struct wl_display *display, struct wlr_renderer *renderer) {
 	if (drm_is_eglstreams(backend->drm_fd)) {
@@ -126,6 +143,7 @@ static bool backend_init(struct wlr_headless_backend *backend,
 	wlr_backend_init(&backend->backend, &backend_impl);
 
 	backend->display = display;
+	backend->vblank_jitter = parse_vblank_jitter_env();
 	wl_list_init(&backend->outputs);
 	wl_list_init(&backend->input_devices);
 	wl_list_init(&backend->parent_renderer_destroy.link);
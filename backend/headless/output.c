@@ -1,11 +1,14 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 #include <wlr/interfaces/wlr_output.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/util/log.h>
 #include "backend/headless.h"
 #include "util/signal.h"
+#include "util/time.h"
 
 static struct wlr_headless_output *headless_output_from_output(
 		struct wlr_output *wlr_output) {
@@ -13,6 +16,57 @@ static struct wlr_headless_output *headless_output_from_output(
 	return (struct wlr_headless_output *)wlr_output;
 }
 
+static int64_t get_current_time_nsec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_nsec(&now);
+}
+
+/**
+ * Returns the time of the last simulated vblank at or before `now`, and
+ * stores its sequence number in `seq`.
+ */
+static int64_t output_last_vblank(struct wlr_headless_output *output,
+		int64_t now, uint64_t *seq) {
+	int64_t n = 0;
+	if (now > output->vblank_base) {
+		n = (now - output->vblank_base) / output->refresh_nsec;
+	}
+	*seq = output->vblank_base_seq + n;
+	return output->vblank_base + n * output->refresh_nsec;
+}
+
+static int64_t output_next_jitter(struct wlr_headless_output *output) {
+	int64_t max = output->backend->vblank_jitter;
+	if (max == 0) {
+		return 0;
+	}
+
+	// xorshift32, seeded per output so that runs are reproducible
+	uint32_t x = output->jitter_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	output->jitter_state = x;
+	return (int64_t)(x % (uint64_t)(max + 1));
+}
+
+static void output_send_present(struct wlr_headless_output *output,
+		int64_t vblank, uint64_t seq, uint32_t flags) {
+	struct timespec when;
+	timespec_from_nsec(&when, vblank + output_next_jitter(output));
+
+	struct wlr_output_event_present event = {
+		.commit_seq = output->present_commit_seq,
+		.when = &when,
+		.seq = (unsigned)seq,
+		.refresh = (int)output->refresh_nsec,
+		.flags = flags,
+	};
+	output->present_pending = false;
+	wlr_output_send_present(&output->wlr_output, &event);
+}
+
 static bool output_set_custom_mode(struct wlr_output *wlr_output, int32_t width,
 		int32_t height, int32_t refresh) {
 	struct wlr_headless_output *output =
@@ -24,6 +78,17 @@ static bool output_set_custom_mode(struct wlr_output *wlr_output, int32_t width,
 
 	output->frame_delay = 1000000 / refresh;
 
+	// Keep the vblank phase and counter continuous across mode changes
+	int64_t now = get_current_time_nsec();
+	if (output->refresh_nsec != 0) {
+		output->vblank_base = output_last_vblank(output, now,
+			&output->vblank_base_seq);
+	} else {
+		output->vblank_base = now;
+		output->vblank_base_seq = 0;
+	}
+	output->refresh_nsec = 1000000000000 / refresh;
+
 	wlr_output_update_custom_mode(&output->wlr_output, width, height, refresh);
 	return true;
 }
@@ -65,7 +130,17 @@ static bool output_commit(struct wlr_output *wlr_output) {
 		wlr_buffer_unlock(output->front_buffer);
 		output->front_buffer = wlr_buffer_lock(wlr_output->pending.buffer);
 
-		wlr_output_send_present(wlr_output, NULL);
+		if (output->present_pending) {
+			// The previous buffer has been replaced before reaching a vblank
+			int64_t now = get_current_time_nsec();
+			uint64_t seq;
+			output_last_vblank(output, now, &seq);
+			output_send_present(output, now, seq, 0);
+		}
+
+		// The buffer is presented on the next simulated vblank
+		output->present_pending = true;
+		output->present_commit_seq = wlr_output->commit_seq + 1;
 	}
 
 	return true;
@@ -107,10 +182,32 @@ bool wlr_output_is_headless(struct wlr_output *wlr_output) {
 	return wlr_output->impl == &output_impl;
 }
 
+static void output_schedule_vblank(struct wlr_headless_output *output,
+		int64_t now) {
+	uint64_t seq;
+	int64_t next = output_last_vblank(output, now, &seq) +
+		output->refresh_nsec;
+	// Round up so that the timer doesn't fire before the vblank
+	int delay = (next - now + 999999) / 1000000;
+	wl_event_source_timer_update(output->frame_timer, delay > 0 ? delay : 1);
+}
+
 static int signal_frame(void *data) {
 	struct wlr_headless_output *output = data;
-	wlr_output_send_frame(&output->wlr_output);
-	wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+
+	int64_t now = get_current_time_nsec();
+	uint64_t seq;
+	int64_t vblank = output_last_vblank(output, now, &seq);
+	if (seq != output->vblank_seq) {
+		output->vblank_seq = seq;
+		if (output->present_pending) {
+			output_send_present(output, vblank, seq,
+				WLR_OUTPUT_PRESENT_VSYNC);
+		}
+		wlr_output_send_frame(&output->wlr_output);
+	}
+
+	output_schedule_vblank(output, now);
 	return 0;
 }
 
@@ -126,6 +223,7 @@ struct wlr_output *wlr_headless_add_output(struct wlr_backend *wlr_backend,
 		return NULL;
 	}
 	output->backend = backend;
+	output->jitter_state = 0x9E3779B9u * (uint32_t)(backend->last_output_num + 1);
 	wlr_output_init(&output->wlr_output, &backend->backend, &output_impl,
 		backend->display);
 	struct wlr_output *wlr_output = &output->wlr_output;
@@ -32,6 +32,7 @@
 #include "xdg-shell-client-protocol.h"
 #include "tablet-unstable-v2-client-protocol.h"
 #include "relative-pointer-unstable-v1-client-protocol.h"
+#include "viewporter-client-protocol.h"
 
 struct wlr_wl_backend *get_wl_backend_from_backend(struct wlr_backend *backend) {
 	assert(wlr_backend_is_wl(backend));
@@ -248,6 +249,12 @@ static void registry_global(void *data, struct wl_registry *registry,
 	} else if (strcmp(iface, wl_shm_interface.name) == 0) {
 		wl->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
 		wl_shm_add_listener(wl->shm, &shm_listener, wl);
+	} else if (strcmp(iface, wl_subcompositor_interface.name) == 0) {
+		wl->subcompositor = wl_registry_bind(registry, name,
+			&wl_subcompositor_interface, 1);
+	} else if (strcmp(iface, wp_viewporter_interface.name) == 0) {
+		wl->viewporter = wl_registry_bind(registry, name,
+			&wp_viewporter_interface, 1);
 	}
 }
 
@@ -311,6 +318,8 @@ static void backend_destroy(struct wlr_backend *backend) {
 	wl_list_for_each_safe(buffer, tmp_buffer, &wl->buffers, link) {
 		destroy_wl_buffer(buffer);
 	}
+	hash_table_finish(&wl->buffers_by_buffer);
+	rate_counter_finish(&wl->imports);
 
 	wlr_backend_finish(backend);
 
@@ -342,6 +351,12 @@ static void backend_destroy(struct wlr_backend *backend) {
 	if (wl->zwp_relative_pointer_manager_v1) {
 		zwp_relative_pointer_manager_v1_destroy(wl->zwp_relative_pointer_manager_v1);
 	}
+	if (wl->subcompositor) {
+		wl_subcompositor_destroy(wl->subcompositor);
+	}
+	if (wl->viewporter) {
+		wp_viewporter_destroy(wl->viewporter);
+	}
 	free(wl->drm_render_name);
 	xdg_wm_base_destroy(wl->xdg_wm_base);
 	wl_compositor_destroy(wl->compositor);
@@ -396,6 +411,9 @@ struct wlr_backend *wlr_wl_backend_create(struct wl_display *display,
 	wl_list_init(&wl->outputs);
 	wl_list_init(&wl->seats);
 	wl_list_init(&wl->buffers);
+	rate_counter_init(&wl->imports, wl_display_get_event_loop(display),
+		"wl_buffers created");
+	hash_table_init(&wl->buffers_by_buffer);
 
 	wl->remote_display = wl_display_connect(remote);
 	if (!wl->remote_display) {
@@ -482,3 +500,10 @@ struct wl_display *wlr_wl_backend_get_remote_display(struct wlr_backend *backend
 	struct wlr_wl_backend *wl = get_wl_backend_from_backend(backend);
 	return wl->remote_display;
 }
+
+void wlr_wl_backend_get_import_stats(struct wlr_backend *backend,
+		size_t *total, size_t *per_sec) {
+	struct wlr_wl_backend *wl = get_wl_backend_from_backend(backend);
+	*total = wl->imports.total;
+	*per_sec = wl->imports.last_period;
+}
@@ -24,6 +24,7 @@
 
 #include "linux-dmabuf-unstable-v1-client-protocol.h"
 #include "presentation-time-client-protocol.h"
+#include "viewporter-client-protocol.h"
 #include "xdg-decoration-unstable-v1-client-protocol.h"
 #include "xdg-shell-client-protocol.h"
 
@@ -103,10 +104,32 @@ static bool output_set_custom_mode(struct wlr_output *wlr_output,
 	return true;
 }
 
+static void buffer_unlink(struct wlr_wl_buffer *buffer) {
+	struct hash_table *table = &buffer->backend->buffers_by_buffer;
+	uint64_t key = (uintptr_t)buffer->buffer;
+	struct wlr_wl_buffer *head = hash_table_get(table, key);
+	if (head == buffer) {
+		// Removing the key first guarantees that inserting it back doesn't
+		// need to grow the table, so this can't fail
+		hash_table_remove(table, key);
+		if (buffer->next != NULL) {
+			hash_table_set(table, key, buffer->next);
+		}
+		return;
+	}
+	for (struct wlr_wl_buffer *prev = head; prev != NULL; prev = prev->next) {
+		if (prev->next == buffer) {
+			prev->next = buffer->next;
+			return;
+		}
+	}
+}
+
 void destroy_wl_buffer(struct wlr_wl_buffer *buffer) {
 	if (buffer == NULL) {
 		return;
 	}
+	buffer_unlink(buffer);
 	wl_list_remove(&buffer->buffer_destroy.link);
 	wl_list_remove(&buffer->link);
 	wl_buffer_destroy(buffer->wl_buffer);
@@ -211,9 +234,20 @@ static struct wlr_wl_buffer *create_wl_buffer(struct wlr_wl_backend *wl,
 		wl_buffer_destroy(wl_buffer);
 		return NULL;
 	}
+
+	uint64_t key = (uintptr_t)wlr_buffer;
+	buffer->next = hash_table_get(&wl->buffers_by_buffer, key);
+	if (!hash_table_set(&wl->buffers_by_buffer, key, buffer)) {
+		wl_buffer_destroy(wl_buffer);
+		free(buffer);
+		return NULL;
+	}
+
+	buffer->backend = wl;
 	buffer->wl_buffer = wl_buffer;
 	buffer->buffer = wlr_buffer_lock(wlr_buffer);
 	wl_list_insert(&wl->buffers, &buffer->link);
+	rate_counter_add(&wl->imports);
 
 	wl_buffer_add_listener(wl_buffer, &buffer_listener, buffer);
 
@@ -225,12 +259,13 @@ static struct wlr_wl_buffer *create_wl_buffer(struct wlr_wl_backend *wl,
 
 static struct wlr_wl_buffer *get_or_create_wl_buffer(struct wlr_wl_backend *wl,
 		struct wlr_buffer *wlr_buffer) {
-	struct wlr_wl_buffer *buffer;
-	wl_list_for_each(buffer, &wl->buffers, link) {
+	struct wlr_wl_buffer *buffer =
+		hash_table_get(&wl->buffers_by_buffer, (uintptr_t)wlr_buffer);
+	for (; buffer != NULL; buffer = buffer->next) {
 		// We can only re-use a wlr_wl_buffer if the parent compositor has
 		// released it, because wl_buffer.release is per-wl_buffer, not per
 		// wl_surface.commit.
-		if (buffer->buffer == wlr_buffer && buffer->released) {
+		if (buffer->released) {
 			buffer->released = false;
 			wlr_buffer_lock(buffer->buffer);
 			return buffer;
@@ -240,6 +275,41 @@ static struct wlr_wl_buffer *get_or_create_wl_buffer(struct wlr_wl_backend *wl,
 	return create_wl_buffer(wl, wlr_buffer);
 }
 
+static void overlay_commit(struct wlr_wl_output_overlay *overlay) {
+	if (!overlay->pending.committed) {
+		return;
+	}
+	overlay->pending.committed = false;
+
+	struct wlr_buffer *wlr_buffer = overlay->pending.buffer;
+	overlay->pending.buffer = NULL;
+
+	struct wlr_wl_buffer *buffer = NULL;
+	if (wlr_buffer != NULL) {
+		buffer = get_or_create_wl_buffer(overlay->output->backend, wlr_buffer);
+		wlr_buffer_unlock(wlr_buffer);
+	}
+	if (buffer == NULL) {
+		wl_surface_attach(overlay->surface, NULL, 0, 0);
+		wl_surface_commit(overlay->surface);
+		return;
+	}
+
+	struct wlr_fbox *src = &overlay->pending.src_box;
+	struct wlr_box *dst = &overlay->pending.dst_box;
+	wp_viewport_set_source(overlay->viewport,
+		wl_fixed_from_double(src->x), wl_fixed_from_double(src->y),
+		wl_fixed_from_double(src->width), wl_fixed_from_double(src->height));
+	wp_viewport_set_destination(overlay->viewport, dst->width, dst->height);
+	wl_subsurface_set_position(overlay->subsurface, dst->x, dst->y);
+
+	wl_surface_attach(overlay->surface, buffer->wl_buffer, 0, 0);
+	wl_surface_damage_buffer(overlay->surface, 0, 0, INT32_MAX, INT32_MAX);
+	// The sub-surface is synchronized, the new state is applied along with the
+	// parent surface
+	wl_surface_commit(overlay->surface);
+}
+
 static bool output_test(struct wlr_output *wlr_output) {
 	struct wlr_wl_output *output =
 		get_wl_output_from_output(wlr_output);
@@ -283,12 +353,6 @@ static bool output_commit(struct wlr_output *wlr_output) {
 		assert(wlr_output->pending.buffer_type ==
 			WLR_OUTPUT_STATE_BUFFER_SCANOUT);
 
-		struct wp_presentation_feedback *wp_feedback = NULL;
-		if (output->backend->presentation != NULL) {
-			wp_feedback = wp_presentation_feedback(output->backend->presentation,
-				output->surface);
-		}
-
 		pixman_region32_t *damage = NULL;
 		if (wlr_output->pending.committed & WLR_OUTPUT_STATE_DAMAGE) {
 			damage = &wlr_output->pending.damage;
@@ -299,9 +363,6 @@ static bool output_commit(struct wlr_output *wlr_output) {
 			return false;
 		}
 
-		output->frame_callback = wl_surface_frame(output->surface);
-		wl_callback_add_listener(output->frame_callback, &frame_listener, output);
-
 		struct wlr_buffer *wlr_buffer = wlr_output->pending.buffer;
 		struct wlr_wl_buffer *buffer =
 			get_or_create_wl_buffer(output->backend, wlr_buffer);
@@ -309,6 +370,21 @@ static bool output_commit(struct wlr_output *wlr_output) {
 			return false;
 		}
 
+		output->frame_callback = wl_surface_frame(output->surface);
+		wl_callback_add_listener(output->frame_callback, &frame_listener,
+			output);
+
+		struct wp_presentation_feedback *wp_feedback = NULL;
+		if (output->backend->presentation != NULL) {
+			wp_feedback = wp_presentation_feedback(output->backend->presentation,
+				output->surface);
+		}
+
+		struct wlr_wl_output_overlay *overlay;
+		wl_list_for_each(overlay, &output->overlays, link) {
+			overlay_commit(overlay);
+		}
+
 		wl_surface_attach(output->surface, buffer->wl_buffer, 0, 0);
 
 		if (damage == NULL) {
@@ -404,6 +480,11 @@ static void output_destroy(struct wlr_output *wlr_output) {
 
 	wl_list_remove(&output->link);
 
+	struct wlr_wl_output_overlay *overlay, *overlay_tmp;
+	wl_list_for_each_safe(overlay, overlay_tmp, &output->overlays, link) {
+		wlr_wl_output_overlay_destroy(overlay);
+	}
+
 	if (output->cursor.surface) {
 		wl_surface_destroy(output->cursor.surface);
 	}
@@ -527,6 +608,7 @@ struct wlr_output *wlr_wl_output_create(struct wlr_backend *wlr_backend) {
 
 	output->backend = backend;
 	wl_list_init(&output->presentation_feedbacks);
+	wl_list_init(&output->overlays);
 
 	output->surface = wl_compositor_create_surface(backend->compositor);
 	if (!output->surface) {
@@ -611,3 +693,71 @@ struct wl_surface *wlr_wl_output_get_surface(struct wlr_output *output) {
 	struct wlr_wl_output *wl_output = get_wl_output_from_output(output);
 	return wl_output->surface;
 }
+
+struct wlr_wl_output_overlay *wlr_wl_output_overlay_create(
+		struct wlr_output *wlr_output) {
+	struct wlr_wl_output *output = get_wl_output_from_output(wlr_output);
+	struct wlr_wl_backend *backend = output->backend;
+	if (backend->subcompositor == NULL || backend->viewporter == NULL) {
+		return NULL;
+	}
+
+	struct wlr_wl_output_overlay *overlay = calloc(1, sizeof(*overlay));
+	if (overlay == NULL) {
+		return NULL;
+	}
+	overlay->output = output;
+
+	overlay->surface = wl_compositor_create_surface(backend->compositor);
+	if (overlay->surface == NULL) {
+		free(overlay);
+		return NULL;
+	}
+	// Let input events go through to the output surface
+	wl_surface_set_user_data(overlay->surface, output);
+	struct wl_region *region = wl_compositor_create_region(backend->compositor);
+	wl_surface_set_input_region(overlay->surface, region);
+	wl_region_destroy(region);
+
+	// Sub-surfaces are created on top of their siblings, and are synchronized
+	// with their parent by default
+	overlay->subsurface = wl_subcompositor_get_subsurface(
+		backend->subcompositor, overlay->surface, output->surface);
+	overlay->viewport =
+		wp_viewporter_get_viewport(backend->viewporter, overlay->surface);
+
+	wl_list_insert(output->overlays.prev, &overlay->link);
+
+	return overlay;
+}
+
+void wlr_wl_output_overlay_destroy(struct wlr_wl_output_overlay *overlay) {
+	if (overlay == NULL) {
+		return;
+	}
+	wl_list_remove(&overlay->link);
+	wlr_buffer_unlock(overlay->pending.buffer);
+	wp_viewport_destroy(overlay->viewport);
+	wl_subsurface_destroy(overlay->subsurface);
+	wl_surface_destroy(overlay->surface);
+	free(overlay);
+}
+
+bool wlr_wl_output_overlay_set_buffer(struct wlr_wl_output_overlay *overlay,
+		struct wlr_buffer *buffer, const struct wlr_fbox *src_box,
+		const struct wlr_box *dst_box) {
+	if (buffer != NULL) {
+		if (!test_buffer(overlay->output->backend, buffer) ||
+				wlr_box_empty(dst_box) || src_box->width <= 0 ||
+				src_box->height <= 0) {
+			return false;
+		}
+		overlay->pending.src_box = *src_box;
+		overlay->pending.dst_box = *dst_box;
+	}
+
+	wlr_buffer_unlock(overlay->pending.buffer);
+	overlay->pending.buffer = buffer != NULL ? wlr_buffer_lock(buffer) : NULL;
+	overlay->pending.committed = true;
+	return true;
+}
@@ -125,6 +125,13 @@ static void handle_x11_event(struct wlr_x11_backend *x11,
 	case XCB_MAP_NOTIFY:
 		break;
 	default:
+		if (x11->have_shm_put_image && (event->response_type &
+				XCB_EVENT_RESPONSE_TYPE_MASK) ==
+				x11->shm_first_event + XCB_SHM_COMPLETION) {
+			handle_x11_shm_completion(x11,
+				(xcb_shm_completion_event_t *)event);
+			break;
+		}
 		handle_x11_unknown_event(x11, event);
 		break;
 	}
@@ -188,6 +195,7 @@ static void backend_destroy(struct wlr_backend *backend) {
 	}
 
 	wlr_input_device_destroy(&x11->keyboard_dev);
+	rate_counter_finish(&x11->imports);
 
 	wlr_backend_finish(backend);
 
@@ -218,7 +226,7 @@ static int backend_get_drm_fd(struct wlr_backend *backend) {
 static uint32_t get_buffer_caps(struct wlr_backend *backend) {
 	struct wlr_x11_backend *x11 = get_x11_backend_from_backend(backend);
 	return (x11->have_dri3 ? WLR_BUFFER_CAP_DMABUF : 0)
-		| (x11->have_shm ? WLR_BUFFER_CAP_SHM : 0);
+		| WLR_BUFFER_CAP_SHM;
 }
 
 static const struct wlr_backend_impl backend_impl = {
@@ -232,6 +240,13 @@ bool wlr_backend_is_x11(struct wlr_backend *backend) {
 	return backend->impl == &backend_impl;
 }
 
+void wlr_x11_backend_get_import_stats(struct wlr_backend *backend,
+		size_t *total, size_t *per_sec) {
+	struct wlr_x11_backend *x11 = get_x11_backend_from_backend(backend);
+	*total = x11->imports.total;
+	*per_sec = x11->imports.last_period;
+}
+
 static void handle_display_destroy(struct wl_listener *listener, void *data) {
 	struct wlr_x11_backend *x11 =
 		wl_container_of(listener, x11, display_destroy);
@@ -349,10 +364,10 @@ static bool query_formats(struct wlr_x11_backend *x11) {
 
 		const struct wlr_x11_format *format = x11_format_from_depth(depth);
 		if (format != NULL) {
-			if (x11->have_shm) {
-				wlr_drm_format_set_add(&x11->shm_formats, format->drm,
-					DRM_FORMAT_MOD_INVALID);
-			}
+			// Without shared pixmaps, shm buffers are presented with
+			// (Shm)PutImage, which every server supports
+			wlr_drm_format_set_add(&x11->shm_formats, format->drm,
+				DRM_FORMAT_MOD_INVALID);
 
 			if (x11->have_dri3) {
 				wlr_drm_format_set_add(&x11->dri3_formats, format->drm,
@@ -404,6 +419,8 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 	wlr_backend_init(&x11->backend, &backend_impl);
 	x11->wl_display = display;
 	wl_list_init(&x11->outputs);
+	rate_counter_init(&x11->imports, wl_display_get_event_loop(display),
+		"pixmaps created");
 
 	x11->xcb = xcb_connect(x11_display, NULL);
 	if (!x11->xcb || xcb_connection_has_error(x11->xcb)) {
@@ -477,7 +494,10 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 				if (shm_reply->shared_pixmaps) {
 					x11->have_shm = true;
 				} else {
-					wlr_log(WLR_INFO, "X11 does not support shared pixmaps");
+					wlr_log(WLR_INFO, "X11 does not support shared pixmaps, "
+						"falling back to ShmPutImage");
+					x11->have_shm_put_image = true;
+					x11->shm_first_event = ext->first_event;
 				}
 			} else {
 				wlr_log(WLR_INFO, "X11 does not support required SHM version "
@@ -632,7 +652,7 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 
 	const struct wlr_drm_format *shm_format =
 		wlr_drm_format_set_get(&x11->shm_formats, x11->x11_format->drm);
-	if (x11->have_shm && shm_format != NULL) {
+	if (shm_format != NULL) {
 		wlr_drm_format_set_add(&x11->primary_shm_formats,
 			shm_format->format, DRM_FORMAT_MOD_INVALID);
 	}
@@ -79,6 +79,12 @@ static void output_destroy(struct wlr_output *wlr_output) {
 	wl_list_for_each_safe(buffer, buffer_tmp, &output->buffers, link) {
 		destroy_x11_buffer(buffer);
 	}
+	hash_table_finish(&output->buffers_by_buffer);
+	hash_table_finish(&output->buffers_by_xid);
+
+	if (output->gc != XCB_NONE) {
+		xcb_free_gc(x11->xcb, output->gc);
+	}
 
 	wl_list_remove(&output->link);
 
@@ -110,9 +116,18 @@ static void destroy_x11_buffer(struct wlr_x11_buffer *buffer) {
 	if (!buffer) {
 		return;
 	}
+	hash_table_remove(&buffer->output->buffers_by_buffer,
+		(uintptr_t)buffer->buffer);
+	hash_table_remove(&buffer->output->buffers_by_xid,
+		buffer->pixmap != XCB_PIXMAP_NONE ? buffer->pixmap : buffer->shm_seg);
 	wl_list_remove(&buffer->buffer_destroy.link);
 	wl_list_remove(&buffer->link);
-	xcb_free_pixmap(buffer->x11->xcb, buffer->pixmap);
+	if (buffer->pixmap != XCB_PIXMAP_NONE) {
+		xcb_free_pixmap(buffer->x11->xcb, buffer->pixmap);
+	}
+	if (buffer->shm_seg != XCB_NONE) {
+		xcb_shm_detach(buffer->x11->xcb, buffer->shm_seg);
+	}
 	free(buffer);
 }
 
@@ -201,52 +216,257 @@ static xcb_pixmap_t import_shm(struct wlr_x11_output *output,
 	return pixmap;
 }
 
+static xcb_shm_seg_t attach_shm(struct wlr_x11_output *output,
+		struct wlr_shm_attributes *shm) {
+	struct wlr_x11_backend *x11 = output->x11;
+
+	if (shm->format != x11->x11_format->drm) {
+		// ShmPutImage doesn't convert between formats
+		return XCB_NONE;
+	}
+
+	// xcb closes the FD after sending it
+	int fd = fcntl(shm->fd, F_DUPFD_CLOEXEC, 0);
+	if (fd < 0) {
+		wlr_log_errno(WLR_ERROR, "fcntl(F_DUPFD_CLOEXEC) failed");
+		return XCB_NONE;
+	}
+
+	xcb_shm_seg_t seg = xcb_generate_id(x11->xcb);
+	xcb_shm_attach_fd(x11->xcb, seg, fd, true);
+
+	return seg;
+}
+
 static struct wlr_x11_buffer *create_x11_buffer(struct wlr_x11_output *output,
 		struct wlr_buffer *wlr_buffer) {
 	struct wlr_x11_backend *x11 = output->x11;
 	xcb_pixmap_t pixmap = XCB_PIXMAP_NONE;
+	xcb_shm_seg_t shm_seg = XCB_NONE;
 
 	struct wlr_dmabuf_attributes dmabuf_attrs;
 	struct wlr_shm_attributes shm_attrs;
 	if (wlr_buffer_get_dmabuf(wlr_buffer, &dmabuf_attrs)) {
 		pixmap = import_dmabuf(output, &dmabuf_attrs);
 	} else if (wlr_buffer_get_shm(wlr_buffer, &shm_attrs)) {
-		pixmap = import_shm(output, &shm_attrs);
+		if (x11->have_shm) {
+			pixmap = import_shm(output, &shm_attrs);
+		} else if (x11->have_shm_put_image) {
+			shm_seg = attach_shm(output, &shm_attrs);
+		}
 	}
 
-	if (pixmap == XCB_PIXMAP_NONE) {
+	if (pixmap == XCB_PIXMAP_NONE && shm_seg == XCB_NONE) {
 		return NULL;
 	}
 
 	struct wlr_x11_buffer *buffer = calloc(1, sizeof(struct wlr_x11_buffer));
 	if (!buffer) {
-		xcb_free_pixmap(x11->xcb, pixmap);
-		return NULL;
+		goto error_xid;
+	}
+	if (!hash_table_set(&output->buffers_by_buffer, (uintptr_t)wlr_buffer,
+			buffer)) {
+		goto error_buffer;
+	}
+	uint32_t xid = pixmap != XCB_PIXMAP_NONE ? pixmap : shm_seg;
+	if (!hash_table_set(&output->buffers_by_xid, xid, buffer)) {
+		hash_table_remove(&output->buffers_by_buffer, (uintptr_t)wlr_buffer);
+		goto error_buffer;
 	}
 	buffer->buffer = wlr_buffer_lock(wlr_buffer);
 	buffer->pixmap = pixmap;
+	buffer->shm_seg = shm_seg;
 	buffer->x11 = x11;
+	buffer->output = output;
 	wl_list_insert(&output->buffers, &buffer->link);
+	rate_counter_add(&x11->imports);
 
 	buffer->buffer_destroy.notify = buffer_handle_buffer_destroy;
 	wl_signal_add(&wlr_buffer->events.destroy, &buffer->buffer_destroy);
 
 	return buffer;
+
+error_buffer:
+	free(buffer);
+error_xid:
+	if (pixmap != XCB_PIXMAP_NONE) {
+		xcb_free_pixmap(x11->xcb, pixmap);
+	}
+	if (shm_seg != XCB_NONE) {
+		xcb_shm_detach(x11->xcb, shm_seg);
+	}
+	return NULL;
 }
 
 static struct wlr_x11_buffer *get_or_create_x11_buffer(
 		struct wlr_x11_output *output, struct wlr_buffer *wlr_buffer) {
-	struct wlr_x11_buffer *buffer;
-	wl_list_for_each(buffer, &output->buffers, link) {
-		if (buffer->buffer == wlr_buffer) {
-			wlr_buffer_lock(buffer->buffer);
-			return buffer;
-		}
+	struct wlr_x11_buffer *buffer =
+		hash_table_get(&output->buffers_by_buffer, (uintptr_t)wlr_buffer);
+	if (buffer != NULL) {
+		wlr_buffer_lock(buffer->buffer);
+		return buffer;
 	}
 
 	return create_x11_buffer(output, wlr_buffer);
 }
 
+static bool output_shm_put_image(struct wlr_x11_output *output,
+		struct wlr_buffer *buffer, const struct wlr_shm_attributes *shm,
+		const pixman_region32_t *damage) {
+	struct wlr_x11_backend *x11 = output->x11;
+
+	struct wlr_x11_buffer *x11_buffer =
+		get_or_create_x11_buffer(output, buffer);
+	if (!x11_buffer) {
+		return false;
+	}
+	assert(x11_buffer->shm_seg != XCB_NONE);
+
+	int rects_len = 0;
+	const pixman_box32_t *rects =
+		pixman_region32_rectangles(damage, &rects_len);
+	if (rects_len == 0) {
+		wlr_buffer_unlock(x11_buffer->buffer);
+		return true;
+	}
+
+	// The server reads from the segment asynchronously. The buffer stays
+	// locked until the ShmCompletion event of the last request arrives.
+	uint16_t total_width = shm->stride / (x11->x11_format->bpp / 8);
+	for (int i = 0; i < rects_len; i++) {
+		const pixman_box32_t *box = &rects[i];
+		xcb_shm_put_image(x11->xcb, output->win, output->gc,
+			total_width, shm->height, box->x1, box->y1,
+			box->x2 - box->x1, box->y2 - box->y1, box->x1, box->y1,
+			x11->x11_format->depth, XCB_IMAGE_FORMAT_Z_PIXMAP,
+			i == rects_len - 1, x11_buffer->shm_seg, shm->offset);
+	}
+
+	return true;
+}
+
+static bool output_put_image(struct wlr_x11_output *output,
+		struct wlr_buffer *buffer, const pixman_region32_t *damage) {
+	struct wlr_x11_backend *x11 = output->x11;
+
+	void *data;
+	uint32_t format;
+	size_t stride;
+	if (!buffer_begin_data_ptr_access(buffer, &data, &format, &stride)) {
+		wlr_log(WLR_DEBUG, "Buffer doesn't support data pointer access");
+		return false;
+	}
+	if (format != x11->x11_format->drm) {
+		// PutImage doesn't convert between formats
+		buffer_end_data_ptr_access(buffer);
+		return false;
+	}
+
+	// Rectangles which don't fit in a single request are split into bands
+	size_t bytes_per_pixel = x11->x11_format->bpp / 8;
+	size_t max_len = (size_t)xcb_get_maximum_request_length(x11->xcb) * 4 -
+		sizeof(xcb_put_image_request_t);
+
+	int rects_len = 0;
+	const pixman_box32_t *rects =
+		pixman_region32_rectangles(damage, &rects_len);
+
+	bool ok = true;
+	uint8_t *packed = NULL;
+	size_t packed_cap = 0;
+	for (int i = 0; i < rects_len && ok; i++) {
+		const pixman_box32_t *box = &rects[i];
+		size_t row_len = (box->x2 - box->x1) * bytes_per_pixel;
+		int band_height = max_len / row_len;
+		if (band_height == 0) {
+			wlr_log(WLR_ERROR, "Damage rectangle too wide for PutImage");
+			ok = false;
+			break;
+		}
+
+		for (int y = box->y1; y < box->y2; y += band_height) {
+			int height = box->y2 - y < band_height ? box->y2 - y : band_height;
+			size_t len = row_len * height;
+			const uint8_t *src = (const uint8_t *)data + y * stride +
+				box->x1 * bytes_per_pixel;
+
+			// PutImage has no stride: rows need to be packed unless the
+			// rectangle spans the whole buffer width
+			if (row_len != stride) {
+				if (len > packed_cap) {
+					uint8_t *new_packed = realloc(packed, len);
+					if (new_packed == NULL) {
+						wlr_log_errno(WLR_ERROR, "Allocation failed");
+						ok = false;
+						break;
+					}
+					packed = new_packed;
+					packed_cap = len;
+				}
+				for (int row = 0; row < height; row++) {
+					memcpy(packed + row * row_len, src + row * stride, row_len);
+				}
+				src = packed;
+			}
+
+			xcb_put_image(x11->xcb, XCB_IMAGE_FORMAT_Z_PIXMAP, output->win,
+				output->gc, box->x2 - box->x1, height, box->x1, y, 0,
+				x11->x11_format->depth, len, src);
+		}
+	}
+
+	free(packed);
+	buffer_end_data_ptr_access(buffer);
+	return ok;
+}
+
+static bool output_commit_put_image(struct wlr_x11_output *output) {
+	struct wlr_x11_backend *x11 = output->x11;
+	struct wlr_output *wlr_output = &output->wlr_output;
+	struct wlr_buffer *buffer = wlr_output->pending.buffer;
+
+	// Unlike a presented pixmap, the window keeps its previous contents, so
+	// only the damaged and exposed regions need to be transferred
+	pixman_region32_t damage;
+	if (wlr_output->pending.committed & WLR_OUTPUT_STATE_DAMAGE) {
+		pixman_region32_init(&damage);
+		pixman_region32_union(&damage, &output->exposed,
+			&wlr_output->pending.damage);
+		pixman_region32_intersect_rect(&damage, &damage,
+			0, 0, buffer->width, buffer->height);
+	} else {
+		pixman_region32_init_rect(&damage,
+			0, 0, buffer->width, buffer->height);
+	}
+
+	if (output->gc == XCB_NONE) {
+		output->gc = xcb_generate_id(x11->xcb);
+		xcb_create_gc(x11->xcb, output->gc, output->win, 0, NULL);
+	}
+
+	bool ok;
+	struct wlr_shm_attributes shm;
+	if (x11->have_shm_put_image && wlr_buffer_get_shm(buffer, &shm)) {
+		ok = output_shm_put_image(output, buffer, &shm, &damage);
+	} else {
+		ok = output_put_image(output, buffer, &damage);
+	}
+	pixman_region32_fini(&damage);
+	if (!ok) {
+		return false;
+	}
+
+	pixman_region32_clear(&output->exposed);
+
+	// PutImage doesn't generate any Present event, request one to keep
+	// sending present and frame events
+	uint64_t target_msc = output->last_msc ? output->last_msc + 1 : 0;
+	xcb_present_notify_msc(x11->xcb, output->win, wlr_output->commit_seq,
+		target_msc, 0, 0);
+
+	return true;
+}
+
 static bool output_commit_buffer(struct wlr_x11_output *output) {
 	struct wlr_x11_backend *x11 = output->x11;
 
@@ -254,6 +474,13 @@ static bool output_commit_buffer(struct wlr_x11_output *output) {
 		WLR_OUTPUT_STATE_BUFFER_SCANOUT);
 
 	struct wlr_buffer *buffer = output->wlr_output.pending.buffer;
+
+	// Without shared pixmaps, only DMA-BUFs can be presented as pixmaps
+	struct wlr_dmabuf_attributes dmabuf;
+	if (!x11->have_shm && !wlr_buffer_get_dmabuf(buffer, &dmabuf)) {
+		return output_commit_put_image(output);
+	}
+
 	struct wlr_x11_buffer *x11_buffer =
 		get_or_create_x11_buffer(output, buffer);
 	if (!x11_buffer) {
@@ -476,7 +703,7 @@ static const struct wlr_drm_format_set *output_get_primary_formats(
 
 	if (x11->have_dri3 && (buffer_caps & WLR_BUFFER_CAP_DMABUF)) {
 		return &output->x11->primary_dri3_formats;
-	} else if (x11->have_shm && (buffer_caps & WLR_BUFFER_CAP_SHM)) {
+	} else if (buffer_caps & WLR_BUFFER_CAP_SHM) {
 		return &output->x11->primary_shm_formats;
 	}
 	return NULL;
@@ -505,6 +732,8 @@ struct wlr_output *wlr_x11_output_create(struct wlr_backend *backend) {
 	}
 	output->x11 = x11;
 	wl_list_init(&output->buffers);
+	hash_table_init(&output->buffers_by_buffer);
+	hash_table_init(&output->buffers_by_xid);
 	pixman_region32_init(&output->exposed);
 
 	struct wlr_output *wlr_output = &output->wlr_output;
@@ -632,14 +861,8 @@ void wlr_x11_output_set_title(struct wlr_output *output, const char *title) {
 }
 
 static struct wlr_x11_buffer *get_x11_buffer(struct wlr_x11_output *output,
-		xcb_pixmap_t pixmap) {
-	struct wlr_x11_buffer *buffer;
-	wl_list_for_each(buffer, &output->buffers, link) {
-		if (buffer->pixmap == pixmap) {
-			return buffer;
-		}
-	}
-	return NULL;
+		uint32_t xid) {
+	return hash_table_get(&output->buffers_by_xid, xid);
 }
 
 void handle_x11_present_event(struct wlr_x11_backend *x11,
@@ -701,3 +924,21 @@ void handle_x11_present_event(struct wlr_x11_backend *x11,
 		wlr_log(WLR_DEBUG, "Unhandled Present event %"PRIu16, event->event_type);
 	}
 }
+
+void handle_x11_shm_completion(struct wlr_x11_backend *x11,
+		xcb_shm_completion_event_t *event) {
+	struct wlr_x11_output *output =
+		get_x11_output_from_window_id(x11, event->drawable);
+	if (!output) {
+		wlr_log(WLR_DEBUG, "Got ShmCompletion event for unknown window");
+		return;
+	}
+
+	struct wlr_x11_buffer *buffer = get_x11_buffer(output, event->shmseg);
+	if (!buffer) {
+		wlr_log(WLR_DEBUG, "Got ShmCompletion event for unknown segment");
+		return;
+	}
+
+	wlr_buffer_unlock(buffer->buffer); // may destroy buffer
+}
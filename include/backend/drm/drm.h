@@ -15,6 +15,7 @@
 #include "backend/drm/iface.h"
 #include "backend/drm/properties.h"
 #include "backend/drm/renderer.h"
+#include "util/hash_table.h"
 
 struct wlr_drm_plane {
 	uint32_t type;
@@ -79,7 +80,11 @@ struct wlr_drm_backend {
 	struct wl_listener dev_remove;
 
 	struct wl_list fbs; // wlr_drm_fb.link
+	struct hash_table fbs_by_buffer; // wlr_buffer pointer -> wlr_drm_fb
+	struct wlr_drm_fb_stats fb_stats;
 	struct wl_list outputs;
+	// CRTC ID -> wlr_drm_connector waiting for a page-flip on that CRTC
+	struct hash_table page_flips;
 
 	struct wlr_drm_renderer renderer;
 	struct wlr_session *session;
@@ -17,6 +17,7 @@ struct wlr_headless_backend {
 	struct wlr_renderer *parent_renderer;
 	struct wl_listener parent_renderer_destroy;
 	bool started;
+	int64_t vblank_jitter; // nsec, maximum simulated timestamp jitter
 };
 
 struct wlr_headless_output {
@@ -29,6 +30,17 @@ struct wlr_headless_output {
 
 	struct wl_event_source *frame_timer;
 	int frame_delay; // ms
+
+	// Simulated vblank clock, in CLOCK_MONOTONIC nanoseconds. Vblank number
+	// `vblank_base_seq + n` happens at `vblank_base + n * refresh_nsec`.
+	int64_t refresh_nsec;
+	int64_t vblank_base;
+	uint64_t vblank_base_seq;
+	uint64_t vblank_seq; // last signalled vblank
+	uint32_t jitter_state;
+
+	bool present_pending;
+	uint32_t present_commit_seq;
 };
 
 struct wlr_headless_input_device {
@@ -12,6 +12,9 @@
 #include <wlr/types/wlr_pointer.h>
 #include <wlr/render/drm_format_set.h>
 
+#include "util/hash_table.h"
+#include "util/rate_counter.h"
+
 struct wlr_wl_backend {
 	struct wlr_backend backend;
 
@@ -22,6 +25,8 @@ struct wlr_wl_backend {
 	struct wl_list outputs;
 	int drm_fd;
 	struct wl_list buffers; // wlr_wl_buffer.link
+	struct hash_table buffers_by_buffer; // wlr_buffer -> wlr_wl_buffer
+	struct rate_counter imports; // wl_buffers created
 	size_t requested_outputs;
 	size_t last_output_num;
 	struct wl_listener local_display_destroy;
@@ -43,14 +48,20 @@ struct wlr_wl_backend {
 	struct wlr_drm_format_set shm_formats;
 	struct wlr_drm_format_set linux_dmabuf_v1_formats;
 	struct wl_drm *legacy_drm;
+	struct wl_subcompositor *subcompositor;
+	struct wp_viewporter *viewporter;
 	char *drm_render_name;
 };
 
 struct wlr_wl_buffer {
+	struct wlr_wl_backend *backend;
 	struct wlr_buffer *buffer;
 	struct wl_buffer *wl_buffer;
 	bool released;
 	struct wl_list link; // wlr_wl_backend.buffers
+	// Next wlr_wl_buffer importing the same wlr_buffer, see
+	// wlr_wl_backend.buffers_by_buffer
+	struct wlr_wl_buffer *next;
 	struct wl_listener buffer_destroy;
 };
 
@@ -61,6 +72,23 @@ struct wlr_wl_presentation_feedback {
 	uint32_t commit_seq;
 };
 
+struct wlr_wl_output_overlay {
+	struct wlr_wl_output *output;
+	struct wl_list link; // wlr_wl_output.overlays, bottom to top
+
+	struct wl_surface *surface;
+	struct wl_subsurface *subsurface;
+	struct wp_viewport *viewport;
+
+	// Applied on the next output buffer commit
+	struct {
+		bool committed;
+		struct wlr_buffer *buffer; // NULL to hide the overlay
+		struct wlr_fbox src_box;
+		struct wlr_box dst_box;
+	} pending;
+};
+
 struct wlr_wl_output {
 	struct wlr_output wlr_output;
 
@@ -69,6 +97,7 @@ struct wlr_wl_output {
 
 	struct wl_surface *surface;
 	struct wl_callback *frame_callback;
+	struct wl_list overlays; // wlr_wl_output_overlay.link
 	struct xdg_surface *xdg_surface;
 	struct xdg_toplevel *xdg_toplevel;
 	struct zxdg_toplevel_decoration_v1 *zxdg_toplevel_decoration_v1;
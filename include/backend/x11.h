@@ -8,6 +8,7 @@
 #include <wayland-server-core.h>
 #include <xcb/xcb.h>
 #include <xcb/present.h>
+#include <xcb/shm.h>
 
 #if HAS_XCB_ERRORS
 #include <xcb/xcb_errors.h>
@@ -22,6 +23,9 @@
 #include <wlr/interfaces/wlr_touch.h>
 #include <wlr/render/drm_format_set.h>
 
+#include "util/hash_table.h"
+#include "util/rate_counter.h"
+
 #define XCB_EVENT_RESPONSE_TYPE_MASK 0x7f
 
 struct wlr_x11_backend;
@@ -42,6 +46,13 @@ struct wlr_x11_output {
 	struct wl_list touchpoints; // wlr_x11_touchpoint::link
 
 	struct wl_list buffers; // wlr_x11_buffer::link
+	struct hash_table buffers_by_buffer; // wlr_buffer -> wlr_x11_buffer
+	// wlr_x11_buffer.pixmap or wlr_x11_buffer.shm_seg -> wlr_x11_buffer
+	struct hash_table buffers_by_xid;
+
+	// Used to push damage with PutImage when buffers can't be imported as
+	// pixmaps, XCB_NONE until then
+	xcb_gcontext_t gc;
 
 	pixman_region32_t exposed;
 
@@ -72,10 +83,16 @@ struct wlr_x11_backend {
 	xcb_cursor_t transparent_cursor;
 	xcb_render_pictformat_t argb32;
 
-	bool have_shm;
+	bool have_shm; // MIT-SHM with shared pixmaps
+	// MIT-SHM with FD passing, used for ShmPutImage when the server can't
+	// create shared pixmaps
+	bool have_shm_put_image;
+	uint8_t shm_first_event;
 	bool have_dri3;
 	uint32_t dri3_major_version, dri3_minor_version;
 
+	struct rate_counter imports; // pixmaps created
+
 	size_t requested_outputs;
 	size_t last_output_num;
 	struct wl_list outputs; // wlr_x11_output::link
@@ -114,8 +131,10 @@ struct wlr_x11_backend {
 
 struct wlr_x11_buffer {
 	struct wlr_x11_backend *x11;
+	struct wlr_x11_output *output;
 	struct wlr_buffer *buffer;
-	xcb_pixmap_t pixmap;
+	xcb_pixmap_t pixmap; // XCB_PIXMAP_NONE if presented with ShmPutImage
+	xcb_shm_seg_t shm_seg; // XCB_NONE if presented as a pixmap
 	struct wl_list link; // wlr_x11_output::buffers
 	struct wl_listener buffer_destroy;
 };
@@ -144,5 +163,7 @@ void handle_x11_configure_notify(struct wlr_x11_output *output,
 	xcb_configure_notify_event_t *event);
 void handle_x11_present_event(struct wlr_x11_backend *x11,
 	xcb_ge_generic_event_t *event);
+void handle_x11_shm_completion(struct wlr_x11_backend *x11,
+	xcb_shm_completion_event_t *event);
 
 #endif
@@ -14,6 +14,9 @@
 #include <wlr/render/wlr_texture.h>
 #include <wlr/util/log.h>
 
+// Maximum number of quads accumulated before a batch is flushed
+#define WLR_GLES2_BATCH_MAX_QUADS 256
+
 struct wlr_gles2_pixel_format {
 	uint32_t drm_format;
 	GLint gl_format, gl_type;
@@ -43,6 +46,9 @@ struct wlr_gles2_renderer {
 		bool debug_khr;
 		bool egl_image_external_oes;
 		bool egl_image_oes;
+		// GLES 3.0 pixel buffer objects and fence syncs, used for
+		// asynchronous read-backs
+		bool pbo;
 	} exts;
 
 	struct {
@@ -52,6 +58,13 @@ struct wlr_gles2_renderer {
 		PFNGLPOPDEBUGGROUPKHRPROC glPopDebugGroupKHR;
 		PFNGLPUSHDEBUGGROUPKHRPROC glPushDebugGroupKHR;
 		PFNGLEGLIMAGETARGETRENDERBUFFERSTORAGEOESPROC glEGLImageTargetRenderbufferStorageOES;
+		// GLES 3.0 entry points, with the signatures of their GLES2
+		// extension counterparts
+		PFNGLMAPBUFFERRANGEEXTPROC glMapBufferRange;
+		PFNGLUNMAPBUFFEROESPROC glUnmapBuffer;
+		PFNGLFENCESYNCAPPLEPROC glFenceSync;
+		PFNGLCLIENTWAITSYNCAPPLEPROC glClientWaitSync;
+		PFNGLDELETESYNCAPPLEPROC glDeleteSync;
 	} procs;
 
 	struct {
@@ -68,10 +81,36 @@ struct wlr_gles2_renderer {
 
 	struct wl_list buffers; // wlr_gles2_buffer.link
 	struct wl_list textures; // wlr_gles2_texture.link
+	struct wl_list readbacks; // wlr_gles2_readback.link
 
 	struct wlr_gles2_buffer *current_buffer;
 	uint32_t viewport_width, viewport_height;
 	struct wl_list client_streams; //wlr_egl_client_stream.link
+
+	// GL state as last set by the renderer, used to skip redundant calls when
+	// batching is enabled. Only valid between begin and end.
+	struct {
+		GLuint program;
+		uint32_t attribs; // bitmask of enabled vertex attrib arrays
+	} gl_state;
+
+	// Quads sharing a shader, texture and alpha (or color) are accumulated
+	// here and submitted with a single draw call. Vertices are transformed on
+	// the CPU, the proj uniform is always the identity.
+	struct {
+		bool enabled;
+		size_t n_quads;
+		struct wlr_gles2_tex_shader *tex_shader; // NULL for colored quads
+		struct wlr_gles2_texture *texture;
+		float alpha;
+		float color[4];
+		GLfloat pos[WLR_GLES2_BATCH_MAX_QUADS * 12];
+		GLfloat texcoord[WLR_GLES2_BATCH_MAX_QUADS * 12];
+	} batch;
+
+	struct {
+		uint32_t gl_calls; // issued by render passes since the last begin
+	} stats;
 };
 
 struct wlr_gles2_buffer {
@@ -87,6 +126,18 @@ struct wlr_gles2_buffer {
 	struct wl_listener buffer_destroy;
 };
 
+struct wlr_gles2_readback {
+	struct wlr_renderer_readback base;
+	struct wlr_gles2_renderer *renderer; // NULL if the renderer is destroyed
+	struct wl_list link; // wlr_gles2_renderer.readbacks
+
+	const struct wlr_gles2_pixel_format *fmt;
+	uint32_t flags; // enum wlr_renderer_read_pixels_flags
+	GLuint pbo;
+	GLsync sync;
+	int fence_fd; // -1 if EGL_ANDROID_native_fence_sync is unsupported
+};
+
 struct wlr_gles2_texture {
 	struct wlr_texture wlr_texture;
 	struct wlr_gles2_renderer *renderer;
@@ -147,6 +198,8 @@ void gles2_texture_destroy(struct wlr_gles2_texture *texture);
 struct wlr_texture *gles2_texture_from_wl_eglstream(struct wlr_renderer *wlr_renderer,
 	struct wl_resource *data);
 
+void gles2_flush_batch(struct wlr_gles2_renderer *renderer);
+
 void push_gles2_debug_(struct wlr_gles2_renderer *renderer,
 	const char *file, const char *func);
 #define push_gles2_debug(renderer) push_gles2_debug_(renderer, _WLR_FILENAME, __func__)
@@ -4,6 +4,7 @@
 #include <wlr/render/pixman.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/render/drm_format_set.h>
+#include <wlr/types/wlr_box.h>
 #include "render/pixel_format.h"
 
 struct wlr_pixman_pixel_format {
@@ -11,8 +12,16 @@ struct wlr_pixman_pixel_format {
 	pixman_format_code_t pixman_format;
 };
 
+// Number of solid-fill images kept around for re-use
+#define WLR_PIXMAN_SOLID_FILL_CACHE_SIZE 16
+
 struct wlr_pixman_buffer;
 
+struct wlr_pixman_solid_fill {
+	struct pixman_color color;
+	pixman_image_t *image;
+};
+
 struct wlr_pixman_renderer {
 	struct wlr_renderer wlr_renderer;
 
@@ -22,6 +31,13 @@ struct wlr_pixman_renderer {
 	struct wlr_pixman_buffer *current_buffer;
 	int32_t width, height;
 
+	bool has_scissor;
+	struct wlr_box scissor;
+
+	// Used as a ring buffer, the oldest entry is replaced on a miss
+	struct wlr_pixman_solid_fill solid_fills[WLR_PIXMAN_SOLID_FILL_CACHE_SIZE];
+	size_t solid_fills_next;
+
 	struct wlr_drm_format_set drm_formats;
 };
 
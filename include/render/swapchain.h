@@ -22,14 +22,22 @@ struct wlr_swapchain {
 	struct wlr_drm_format *format;
 	void *backend_data;
 
+	size_t depth; // number of usable slots, at most WLR_SWAPCHAIN_CAP
 	struct wlr_swapchain_slot slots[WLR_SWAPCHAIN_CAP];
 
+	// Statistics, never reset
+	size_t allocations; // number of buffers allocated
+
 	struct wl_listener allocator_destroy;
 };
 
+/**
+ * Create a swap chain holding at most `depth` buffers. If `depth` is zero,
+ * WLR_SWAPCHAIN_CAP is used.
+ */
 struct wlr_swapchain *wlr_swapchain_create(
 	struct wlr_allocator *alloc, int width, int height,
-	const struct wlr_drm_format *format, void *backend_data);
+	const struct wlr_drm_format *format, size_t depth, void *backend_data);
 void wlr_swapchain_destroy(struct wlr_swapchain *swapchain);
 /**
  * Acquire a buffer from the swap chain.
@@ -0,0 +1,45 @@
+#ifndef UTIL_HASH_TABLE_H
+#define UTIL_HASH_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * An open-addressing hash table mapping integer keys to non-NULL pointers.
+ * Pointers can be used as keys by casting them to uintptr_t.
+ */
+struct hash_table_entry {
+	uint64_t key;
+	void *value; // NULL if the slot is empty
+};
+
+struct hash_table {
+	struct hash_table_entry *entries;
+	size_t len, cap; // cap is zero or a power of two
+};
+
+void hash_table_init(struct hash_table *table);
+void hash_table_finish(struct hash_table *table);
+/**
+ * Returns the value associated with the key, or NULL if there is none.
+ */
+void *hash_table_get(const struct hash_table *table, uint64_t key);
+/**
+ * Associates a value with the key, replacing any previous value. Returns
+ * false on allocation failure.
+ */
+bool hash_table_set(struct hash_table *table, uint64_t key, void *value);
+/**
+ * Removes the key from the table. Returns the value which was associated with
+ * it, or NULL if there was none.
+ */
+void *hash_table_remove(struct hash_table *table, uint64_t key);
+/**
+ * Calls the iterator for each entry of the table, in no particular order. The
+ * table must not be modified during the iteration.
+ */
+void hash_table_for_each(const struct hash_table *table,
+	void (*iterator)(uint64_t key, void *value, void *data), void *data);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef UTIL_RATE_COUNTER_H
+#define UTIL_RATE_COUNTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <wayland-server-core.h>
+
+/**
+ * Counts occurrences of an event per one-second period. Periods start with
+ * an occurrence, and the number of occurrences is logged at debug level when
+ * they end.
+ */
+struct rate_counter {
+	const char *name;
+	struct wl_event_loop *loop;
+	struct wl_event_source *timer; // NULL until the first occurrence
+	bool running; // a period is in progress
+
+	size_t total;
+	size_t period; // occurrences in the current period
+	size_t last_period; // occurrences in the last complete period
+};
+
+void rate_counter_init(struct rate_counter *counter,
+	struct wl_event_loop *loop, const char *name);
+void rate_counter_finish(struct rate_counter *counter);
+
+/**
+ * Records one occurrence of the event.
+ */
+void rate_counter_add(struct rate_counter *counter);
+
+#endif
@@ -1,7 +1,16 @@
 #ifndef UTIL_SHM_H
 #define UTIL_SHM_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 int create_shm_file(void);
 int allocate_shm_file(size_t size);
+/**
+ * Allocates a shared memory file and returns two file descriptors for it: a
+ * read-write one and a read-only one. The read-only one can be safely shared
+ * with multiple clients, since none of them can modify its contents.
+ */
+bool allocate_shm_file_pair(size_t size, int *rw_fd, int *ro_fd);
 
 #endif
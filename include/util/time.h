@@ -13,6 +13,11 @@ uint32_t get_current_time_msec(void);
  */
 int64_t timespec_to_msec(const struct timespec *a);
 
+/**
+ * Convert a timespec to nanoseconds.
+ */
+int64_t timespec_to_nsec(const struct timespec *a);
+
 /**
  * Convert nanoseconds to a timespec.
  */
@@ -25,6 +25,16 @@ struct wlr_backend *wlr_drm_backend_create(struct wl_display *display,
 	struct wlr_session *session, struct wlr_device *dev,
 	struct wlr_backend *parent);
 
+/**
+ * Statistics about the KMS framebuffers created by a DRM backend for the
+ * buffers it scans out. The counters are never reset.
+ */
+struct wlr_drm_fb_stats {
+	size_t hits; // a framebuffer already existed for the buffer
+	size_t misses; // a framebuffer had to be created
+	size_t evictions; // framebuffers destroyed along with their buffer
+};
+
 bool wlr_backend_is_drm(struct wlr_backend *backend);
 bool wlr_output_is_drm(struct wlr_output *output);
 
@@ -40,4 +50,10 @@ typedef struct _drmModeModeInfo drmModeModeInfo;
 struct wlr_output_mode *wlr_drm_connector_add_mode(struct wlr_output *output,
 	const drmModeModeInfo *mode);
 
+/**
+ * Get the framebuffer cache statistics of a DRM backend.
+ */
+void wlr_drm_backend_get_fb_stats(struct wlr_backend *backend,
+	struct wlr_drm_fb_stats *stats);
+
 #endif
@@ -4,9 +4,12 @@
 #include <wayland-client.h>
 #include <wayland-server-core.h>
 #include <wlr/backend.h>
+#include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_input_device.h>
 #include <wlr/types/wlr_output.h>
 
+struct wlr_wl_output_overlay;
+
 /**
  * Creates a new wlr_wl_backend. This backend will be created with no outputs;
  * you must use wlr_wl_output_create to add them.
@@ -23,6 +26,15 @@ struct wlr_backend *wlr_wl_backend_create(struct wl_display *display,
  */
 struct wl_display *wlr_wl_backend_get_remote_display(struct wlr_backend *backend);
 
+/**
+ * Gets the number of wl_buffers created by the Wayland backend for output
+ * buffers: in total, and during the last complete one-second period. Buffers
+ * are only imported the first time they are displayed, so a steady per-second
+ * count means the cache isn't working.
+ */
+void wlr_wl_backend_get_import_stats(struct wlr_backend *backend,
+	size_t *total, size_t *per_sec);
+
 /**
  * Adds a new output to this backend. You may remove outputs by destroying them.
  * Note that if called before initializing the backend, this will return NULL
@@ -56,6 +68,34 @@ void wlr_wl_output_set_title(struct wlr_output *output, const char *title);
  */
 struct wl_surface *wlr_wl_output_get_surface(struct wlr_output *output);
 
+/**
+ * Creates an overlay plane on a Wayland output. Overlays are stacked above the
+ * output's primary buffer and above the overlays created before them. They
+ * are backed by sub-surfaces of the output window, so their buffers are
+ * forwarded to the parent compositor without being composited.
+ *
+ * Returns NULL if the parent compositor doesn't support sub-surfaces and
+ * viewports. Overlays are destroyed along with their output.
+ */
+struct wlr_wl_output_overlay *wlr_wl_output_overlay_create(
+	struct wlr_output *output);
+
+void wlr_wl_output_overlay_destroy(struct wlr_wl_output_overlay *overlay);
+
+/**
+ * Sets the buffer displayed by the overlay. `src_box` is the region of the
+ * buffer to display, in buffer coordinates, and `dst_box` is where it is
+ * displayed, in output-buffer-local coordinates. A NULL buffer hides the
+ * overlay.
+ *
+ * The new state is applied along with the next buffer committed on the
+ * output. Returns false if the buffer can't be forwarded to the parent
+ * compositor, in which case it needs to be composited instead.
+ */
+bool wlr_wl_output_overlay_set_buffer(struct wlr_wl_output_overlay *overlay,
+	struct wlr_buffer *buffer, const struct wlr_fbox *src_box,
+	const struct wlr_box *dst_box);
+
 /**
  * Returns the remote wl_seat for a Wayland input device.
  */
@@ -32,6 +32,15 @@ struct wlr_output *wlr_x11_output_create(struct wlr_backend *backend);
  */
 bool wlr_backend_is_x11(struct wlr_backend *backend);
 
+/**
+ * Gets the number of pixmaps created by the X11 backend for output buffers:
+ * in total, and during the last complete one-second period. Buffers are only
+ * imported the first time they are displayed, so a steady per-second count
+ * means the cache isn't working.
+ */
+void wlr_x11_backend_get_import_stats(struct wlr_backend *backend,
+	size_t *total, size_t *per_sec);
+
 /**
  * True if the given input device is a wlr_x11_input_device.
  */
@@ -8,12 +8,12 @@
 struct wlr_drm_format {
 	uint32_t format;
 	size_t len, cap;
-	uint64_t modifiers[];
+	uint64_t modifiers[]; // sorted in ascending order
 };
 
 struct wlr_drm_format_set {
 	size_t len, cap;
-	struct wlr_drm_format **formats;
+	struct wlr_drm_format **formats; // sorted by format code
 };
 
 void wlr_drm_format_set_finish(struct wlr_drm_format_set *set);
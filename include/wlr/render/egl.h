@@ -93,6 +93,7 @@ struct wlr_egl {
 		bool image_base_khr;
 		bool image_dmabuf_import_ext;
 		bool image_dmabuf_import_modifiers_ext;
+		bool native_fence_sync_android;
 
 		// Device extensions
 		bool device_drm_ext;
@@ -110,6 +111,9 @@ struct wlr_egl {
 		PFNEGLDEBUGMESSAGECONTROLKHRPROC eglDebugMessageControlKHR;
 		PFNEGLQUERYDISPLAYATTRIBEXTPROC eglQueryDisplayAttribEXT;
 		PFNEGLQUERYDEVICESTRINGEXTPROC eglQueryDeviceStringEXT;
+		PFNEGLCREATESYNCKHRPROC eglCreateSyncKHR;
+		PFNEGLDESTROYSYNCKHRPROC eglDestroySyncKHR;
+		PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID;
 		// EGLStreams
 		PFNEGLQUERYDEVICESEXTPROC eglQueryDevicesEXT;
 		PFNEGLGETOUTPUTLAYERSEXTPROC eglGetOutputLayersEXT;
@@ -20,6 +20,13 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl);
 
 bool wlr_gles2_renderer_check_ext(struct wlr_renderer *renderer,
 	const char *ext);
+/**
+ * Get the number of GL calls issued by the renderer since the last
+ * wlr_renderer_begin. Called after wlr_renderer_end, this is the number of GL
+ * calls issued for the whole frame. Texture uploads and pixel read-backs
+ * aren't counted.
+ */
+uint32_t wlr_gles2_renderer_get_gl_call_count(struct wlr_renderer *renderer);
 
 struct wlr_gles2_texture_attribs {
 	GLenum target; /* either GL_TEXTURE_2D or GL_TEXTURE_EXTERNAL_OES */
@@ -62,11 +62,26 @@ struct wlr_renderer_impl {
 	struct wlr_texture *(*texture_from_wl_eglstream)(struct wlr_renderer *renderer,
 		struct wl_resource *data);
 	struct wlr_egl *(*get_egl)(struct wlr_renderer *renderer);
+	struct wlr_renderer_readback *(*read_pixels_async)(
+		struct wlr_renderer *renderer, uint32_t fmt, uint32_t width,
+		uint32_t height, uint32_t src_x, uint32_t src_y);
 };
 
 void wlr_renderer_init(struct wlr_renderer *renderer,
 	const struct wlr_renderer_impl *impl);
 
+struct wlr_renderer_readback_impl {
+	bool (*is_ready)(struct wlr_renderer_readback *readback);
+	bool (*finish)(struct wlr_renderer_readback *readback, uint32_t *flags,
+		uint32_t stride, uint32_t dst_x, uint32_t dst_y, void *data);
+	void (*destroy)(struct wlr_renderer_readback *readback);
+	int (*get_fence_fd)(struct wlr_renderer_readback *readback);
+};
+
+void wlr_renderer_readback_init(struct wlr_renderer_readback *readback,
+	const struct wlr_renderer_readback_impl *impl, uint32_t format,
+	uint32_t width, uint32_t height);
+
 struct wlr_texture_impl {
 	bool (*is_opaque)(struct wlr_texture *texture);
 	bool (*write_pixels)(struct wlr_texture *texture,
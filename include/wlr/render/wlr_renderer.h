@@ -107,6 +107,48 @@ bool wlr_renderer_read_pixels(struct wlr_renderer *r, uint32_t fmt,
 	uint32_t *flags, uint32_t stride, uint32_t width, uint32_t height,
 	uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst_y, void *data);
 
+/**
+ * An asynchronous read-back of pixels, see wlr_renderer_read_pixels_async.
+ */
+struct wlr_renderer_readback {
+	const struct wlr_renderer_readback_impl *impl;
+	uint32_t format;
+	uint32_t width, height;
+};
+
+/**
+ * Starts reading out pixels of the currently bound surface without waiting
+ * for the GPU. The pixels can be retrieved with
+ * wlr_renderer_readback_finish once wlr_renderer_readback_is_ready returns
+ * true.
+ *
+ * Returns NULL if the renderer doesn't support asynchronous read-backs or on
+ * failure, in which case the caller should fall back to
+ * wlr_renderer_read_pixels.
+ */
+struct wlr_renderer_readback *wlr_renderer_read_pixels_async(
+	struct wlr_renderer *r, uint32_t fmt, uint32_t width, uint32_t height,
+	uint32_t src_x, uint32_t src_y);
+/**
+ * Checks whether the pixels of the read-back are available, without blocking.
+ */
+bool wlr_renderer_readback_is_ready(struct wlr_renderer_readback *readback);
+/**
+ * Gets a file descriptor which becomes readable once the pixels of the
+ * read-back are available, or -1 if the renderer can't provide one. The FD is
+ * owned by the read-back and stays valid until it is destroyed.
+ */
+int wlr_renderer_readback_get_fence_fd(struct wlr_renderer_readback *readback);
+/**
+ * Copies the pixels of the read-back into data, blocking until they are
+ * available. `stride` is in bytes. `flags` has the same meaning as for
+ * wlr_renderer_read_pixels.
+ */
+bool wlr_renderer_readback_finish(struct wlr_renderer_readback *readback,
+	uint32_t *flags, uint32_t stride, uint32_t dst_x, uint32_t dst_y,
+	void *data);
+void wlr_renderer_readback_destroy(struct wlr_renderer_readback *readback);
+
 /**
  * Creates necessary shm and invokes the initialization of the implementation.
  *
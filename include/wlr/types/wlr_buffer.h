@@ -124,6 +124,10 @@ struct wlr_client_buffer {
 	 */
 	struct wlr_texture *texture;
 
+	// private state
+
+	struct wlr_client_texture_pool *texture_pool; // may be NULL
+
 	struct wl_listener resource_destroy;
 	struct wl_listener release;
 };
@@ -156,8 +160,11 @@ struct wlr_client_buffer *wlr_client_buffer_import(
  * and destroys the provided `buffer`. On error, `buffer` is intact and NULL is
  * returned.
  *
- * Fails if there's more than one reference to the buffer or if the texture
- * isn't mutable.
+ * Only the damaged regions are uploaded. If someone else still has a reference
+ * to the buffer, the contents are uploaded to a texture recycled from previous
+ * buffers of the same size and format instead.
+ *
+ * Fails if the buffer isn't a wl_shm buffer or if the texture isn't mutable.
  */
 struct wlr_client_buffer *wlr_client_buffer_apply_damage(
 	struct wlr_client_buffer *buffer, struct wl_resource *resource,
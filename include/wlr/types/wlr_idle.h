@@ -27,6 +27,14 @@ struct wlr_idle {
 	struct wl_event_loop *event_loop;
 	bool enabled;
 
+	// private state
+
+	// A single timer is shared by all idle timeouts, armed for the earliest
+	// deadline
+	struct wl_event_source *timer_source;
+	int64_t next_deadline; // msec, INT64_MAX if disarmed
+	struct wl_list seats; // wlr_idle_seat::link
+
 	struct wl_listener display_destroy;
 	struct {
 		struct wl_signal activity_notify;
@@ -41,7 +49,6 @@ struct wlr_idle_timeout {
 	struct wl_list link;
 	struct wlr_seat *seat;
 
-	struct wl_event_source *idle_source;
 	bool idle_state;
 	bool enabled;
 	uint32_t timeout; // milliseconds
@@ -52,7 +59,12 @@ struct wlr_idle_timeout {
 		struct wl_signal destroy;
 	} events;
 
-	struct wl_listener input_listener;
+	// private state
+
+	struct wlr_idle *idle;
+	struct wlr_idle_seat *idle_seat;
+	int64_t last_activity; // msec, activity simulated for this timer only
+
 	struct wl_listener seat_destroy;
 
 	void *data;
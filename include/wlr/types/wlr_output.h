@@ -35,6 +35,8 @@ struct wlr_output_cursor {
 
 	// only when using a software cursor without a surface
 	struct wlr_texture *texture;
+	uint64_t texture_hash; // hash of the texture contents
+	void *texture_pixels; // copy of the texture contents, without padding
 
 	// only when using a cursor surface
 	struct wlr_surface *surface;
@@ -103,6 +105,50 @@ struct wlr_output_state {
 
 struct wlr_output_impl;
 
+#define WLR_OUTPUT_BUFFER_AGE_BUCKETS 5
+
+/**
+ * Statistics about the buffers used to render an output.
+ */
+struct wlr_output_swapchain_stats {
+	// Number of buffers allocated
+	size_t allocations;
+	// Number of times no buffer could be acquired to render a frame
+	size_t acquire_failures;
+	// Number of frames rendered per buffer age. Age 0 means the buffer
+	// contents are undefined and the whole output needs to be repainted. The
+	// last bucket also counts frames with an older buffer age.
+	size_t buffer_ages[WLR_OUTPUT_BUFFER_AGE_BUCKETS];
+};
+
+#define WLR_OUTPUT_RENDER_TIME_SAMPLES 8
+
+/**
+ * State used to delay `frame` events until just before the predicted render
+ * deadline, see wlr_output_set_frame_scheduling. Times are in nanoseconds,
+ * on the backend's presentation clock.
+ */
+struct wlr_output_frame_scheduler {
+	bool enabled;
+	int64_t margin; // safety margin kept before the deadline
+
+	// Time between recent frame events and the matching buffer commits
+	int64_t render_times[WLR_OUTPUT_RENDER_TIME_SAMPLES];
+	size_t render_times_len, render_times_next;
+
+	int64_t last_present; // last presentation time, zero if unknown
+	int64_t refresh; // refresh period, zero if unknown
+	int64_t frame_time; // when the last frame event was sent, zero if none
+	int64_t deadline; // vblank targeted by the last committed frame
+	uint32_t deadline_commit_seq;
+
+	// Number of committed frames presented after their targeted vblank
+	size_t missed_deadlines;
+
+	bool scheduled; // a frame event is waiting for the timer
+	struct wl_event_source *timer;
+};
+
 /**
  * A compositor output region. This typically corresponds to a monitor that
  * displays part of the compositor space.
@@ -183,10 +229,15 @@ struct wlr_output {
 	struct wlr_output_cursor *hardware_cursor;
 	struct wlr_swapchain *cursor_swapchain;
 	struct wlr_buffer *cursor_front_buffer;
+	struct wl_list cursor_buffer_cache; // most recently used first
 	int software_cursor_locks; // number of locks forcing software cursors
 
 	struct wlr_swapchain *swapchain;
 	struct wlr_buffer *back_buffer;
+	size_t swapchain_depth; // 0 for the default
+	struct wlr_output_swapchain_stats swapchain_stats;
+
+	struct wlr_output_frame_scheduler frame_scheduler;
 
 	struct wl_listener display_destroy;
 
@@ -207,6 +258,7 @@ struct wlr_output_event_commit {
 	struct wlr_output *output;
 	uint32_t committed; // bitmask of enum wlr_output_state_field
 	struct timespec *when;
+	struct wlr_buffer *buffer; // NULL if no buffer is committed
 };
 
 enum wlr_output_present_flag {
@@ -341,6 +393,23 @@ bool wlr_output_attach_render(struct wlr_output *output, int *buffer_age);
  */
 void wlr_output_attach_buffer(struct wlr_output *output,
 	struct wlr_buffer *buffer);
+/**
+ * Attempt to attach the surface's current buffer for direct scan-out, skipping
+ * composition. This only succeeds if the surface alone covers the whole
+ * output: its buffer must be opaque, have the output's size and transform, be
+ * displayable by the primary plane, and no software cursor or sub-surface may
+ * need to be drawn on top of it.
+ *
+ * On success the buffer is attached and has passed `wlr_output_test`: the
+ * compositor should call `wlr_output_commit` instead of rendering. The
+ * `present` event will have the `WLR_OUTPUT_PRESENT_ZERO_COPY` flag set if the
+ * buffer has been displayed without any copy. On failure the pending state is
+ * left untouched and the compositor should render as usual.
+ *
+ * No buffer must be pending when calling this function.
+ */
+bool wlr_output_attach_surface_scanout(struct wlr_output *output,
+	struct wlr_surface *surface);
 /**
  * Get the preferred format for reading pixels.
  * This function might change the current rendering context.
@@ -379,6 +448,31 @@ bool wlr_output_commit(struct wlr_output *output);
  * Discard the pending output state.
  */
 void wlr_output_rollback(struct wlr_output *output);
+/**
+ * Sets the maximum number of buffers used to render the output. Two buffers
+ * allow double buffering, three allow triple buffering. A depth of zero
+ * restores the default. Returns false if the depth is not supported or if
+ * called between `wlr_output_attach_render` and `wlr_output_commit`.
+ *
+ * The buffers are re-allocated the next time the output is rendered.
+ */
+bool wlr_output_set_swapchain_depth(struct wlr_output *output, size_t depth);
+/**
+ * Enables or disables frame scheduling. Disabled by default.
+ *
+ * When enabled, `frame` events are delayed so that compositors render as late
+ * as possible before the next vblank, showing more recent input. The render
+ * time is predicted from the time previous frames took between the `frame`
+ * event and `wlr_output_commit`, and `margin_nsec` is kept as a safety margin
+ * on top of it (e.g. to account for GPU work which completes after the
+ * commit). Frames presented later than targeted make the prediction more
+ * conservative.
+ *
+ * Compositors should render and commit right after receiving the `frame`
+ * event for the prediction to be meaningful.
+ */
+void wlr_output_set_frame_scheduling(struct wlr_output *output, bool enabled,
+	int64_t margin_nsec);
 /**
  * Manually schedules a `frame` event. If a `frame` event is already pending,
  * it is a no-op.
@@ -34,7 +34,7 @@
  */
 struct wlr_output_damage {
 	struct wlr_output *output;
-	int max_rects; // max number of damaged rectangles
+	int max_rects; // max number of damaged rectangles, more are merged
 
 	pixman_region32_t current; // in output-local coordinates
 
@@ -89,5 +89,16 @@ void wlr_output_damage_add_whole(struct wlr_output_damage *output_damage);
  */
 void wlr_output_damage_add_box(struct wlr_output_damage *output_damage,
 	struct wlr_box *box);
+/**
+ * Removes a region covered by opaque content from the damage accumulated
+ * since the last frame, in output-buffer-local coordinates. Damage below
+ * opaque content doesn't need to be repainted.
+ *
+ * The opaque content must not have changed since the last frame: damage
+ * caused by the opaque content itself (e.g. because it moved or has been
+ * updated) must be added after this function is called.
+ */
+void wlr_output_damage_subtract_opaque(struct wlr_output_damage *output_damage,
+	pixman_region32_t *opaque);
 
 #endif
@@ -10,13 +10,20 @@
 #define WLR_TYPES_WLR_SCREENCOPY_V1_H
 
 #include <stdbool.h>
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_box.h>
 
+struct wlr_renderer_readback;
+
 struct wlr_screencopy_manager_v1 {
 	struct wl_global *global;
 	struct wl_list frames; // wlr_screencopy_frame_v1::link
 
+	// private state
+
+	struct wl_list textures; // screencopy_texture.link, most recently used first
+
 	struct wl_listener display_destroy;
 
 	struct {
@@ -43,11 +50,13 @@ struct wlr_screencopy_frame_v1 {
 	int stride;
 
 	bool overlay_cursor, cursor_locked;
+	bool output_unlocked; // the output locks were released early
 
 	bool with_damage;
 
 	struct wl_shm_buffer *shm_buffer;
 	struct wlr_dmabuf_v1_buffer *dma_buffer;
+	struct wl_resource *buffer_resource;
 
 	struct wl_listener buffer_destroy;
 
@@ -57,6 +66,15 @@ struct wlr_screencopy_frame_v1 {
 	struct wl_listener output_destroy;
 	struct wl_listener output_enable;
 
+	// Pending asynchronous read-back of an shm frame
+	struct wlr_renderer_readback *readback;
+	// Fence FD source, or timer when the renderer can't provide a fence
+	struct wl_event_source *readback_source;
+	struct timespec readback_when;
+	bool readback_has_damage;
+	struct wlr_box readback_damage;
+	struct wlr_box readback_box; // relative to the frame box
+
 	void *data;
 };
 
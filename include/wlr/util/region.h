@@ -46,6 +46,15 @@ void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
 void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 	int distance);
 
+/**
+ * Approximates a region with at most `max_rects` rectangles. The resulting
+ * region contains `src`, and is chosen so that it covers as few extra pixels
+ * as possible. This is useful to turn heavily fragmented damage into a few
+ * large updates.
+ */
+void wlr_region_simplify(pixman_region32_t *dst, pixman_region32_t *src,
+	int max_rects);
+
 /*
  * Builds the smallest possible region that contains the region rotated about
  * the point (ox, oy).
@@ -61,14 +61,23 @@ struct wlr_xcursor {
 	uint32_t total_delay; /* length of the animation in ms */
 };
 
+struct wlr_xcursor_theme_index;
+
 /**
  * Container for an Xcursor theme.
+ *
+ * For themes loaded with wlr_xcursor_theme_load_lazy(), cursors only contains
+ * the cursors which have been requested so far.
  */
 struct wlr_xcursor_theme {
 	unsigned int cursor_count;
 	struct wlr_xcursor **cursors;
 	char *name;
 	int size;
+
+	// private state
+
+	struct wlr_xcursor_theme_index *index;
 };
 
 /**
@@ -79,11 +88,20 @@ struct wlr_xcursor_theme {
  * moving a window around).
  */
 struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size);
+/**
+ * Same as wlr_xcursor_theme_load(), but only indexes the cursor files of the
+ * theme. A cursor is decoded the first time it's requested with
+ * wlr_xcursor_theme_get_cursor().
+ */
+struct wlr_xcursor_theme *wlr_xcursor_theme_load_lazy(const char *name,
+	int size);
 
 void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme);
 
 /**
  * Obtains a wlr_xcursor image for the specified cursor name (e.g. "left_ptr").
+ *
+ * If the theme has been loaded lazily, this may decode the cursor file.
  */
 struct wlr_xcursor *wlr_xcursor_theme_get_cursor(
 	struct wlr_xcursor_theme *theme, const char *name);
@@ -64,4 +64,12 @@ void
 xcursor_load_theme(const char *theme, int size,
 		    void (*load_callback)(XcursorImages *, void *),
 		    void *user_data);
+
+void
+xcursor_index_theme(const char *theme,
+		    void (*index_callback)(const char *, const char *, void *),
+		    void *user_data);
+
+XcursorImages *
+xcursor_load_file(const char *path, const char *name, int size);
 #endif
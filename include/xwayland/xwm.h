@@ -8,6 +8,7 @@
 #if HAS_XCB_ERRORS
 #include <xcb/xcb_errors.h>
 #endif
+#include "util/hash_table.h"
 #include "xwayland/selection.h"
 
 /* This is in xcb/xcb_event.h, but pulling xcb-util just for a constant
@@ -112,6 +113,8 @@ struct wlr_xwm {
 	// Surfaces in bottom-to-top stacking order, for _NET_CLIENT_LIST_STACKING
 	struct wl_list surfaces_in_stack_order; // wlr_xwayland_surface::stack_link
 	struct wl_list unpaired_surfaces; // wlr_xwayland_surface::unpaired_link
+	// Surfaces indexed by window ID
+	struct hash_table surfaces_by_id; // wlr_xwayland_surface
 
 	struct wlr_drag *drag;
 	struct wlr_xwayland_surface *drag_focus;
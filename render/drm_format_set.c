@@ -19,13 +19,53 @@ void wlr_drm_format_set_finish(struct wlr_drm_format_set *set) {
 	set->formats = NULL;
 }
 
-static struct wlr_drm_format **format_set_get_ref(struct wlr_drm_format_set *set,
+/**
+ * Returns the index of the first format in the set which isn't lower than
+ * the format code. Formats are kept sorted by code.
+ */
+static size_t format_set_lower_bound(const struct wlr_drm_format_set *set,
 		uint32_t format) {
-	for (size_t i = 0; i < set->len; ++i) {
-		if (set->formats[i]->format == format) {
-			return &set->formats[i];
+	size_t lo = 0, hi = set->len;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (set->formats[mid]->format < format) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/**
+ * Returns the index of the first modifier in the format which isn't lower
+ * than the modifier. Modifiers are kept sorted.
+ */
+static size_t format_lower_bound(const struct wlr_drm_format *fmt,
+		uint64_t modifier) {
+	size_t lo = 0, hi = fmt->len;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (fmt->modifiers[mid] < modifier) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
 		}
 	}
+	return lo;
+}
+
+static bool format_has(const struct wlr_drm_format *fmt, uint64_t modifier) {
+	size_t i = format_lower_bound(fmt, modifier);
+	return i < fmt->len && fmt->modifiers[i] == modifier;
+}
+
+static struct wlr_drm_format **format_set_get_ref(struct wlr_drm_format_set *set,
+		uint32_t format) {
+	size_t i = format_set_lower_bound(set, format);
+	if (i < set->len && set->formats[i]->format == format) {
+		return &set->formats[i];
+	}
 
 	return NULL;
 }
@@ -48,13 +88,7 @@ bool wlr_drm_format_set_has(const struct wlr_drm_format_set *set,
 		return true;
 	}
 
-	for (size_t i = 0; i < fmt->len; ++i) {
-		if (fmt->modifiers[i] == modifier) {
-			return true;
-		}
-	}
-
-	return false;
+	return format_has(fmt, modifier);
 }
 
 bool wlr_drm_format_set_add(struct wlr_drm_format_set *set, uint32_t format,
@@ -78,7 +112,7 @@ bool wlr_drm_format_set_add(struct wlr_drm_format_set *set, uint32_t format,
 		size_t new = set->cap ? set->cap * 2 : 4;
 
 		struct wlr_drm_format **tmp = realloc(set->formats,
-			sizeof(*fmt) + sizeof(fmt->modifiers[0]) * new);
+			sizeof(*set->formats) * new);
 		if (!tmp) {
 			wlr_log_errno(WLR_ERROR, "Allocation failed");
 			free(fmt);
@@ -89,7 +123,11 @@ bool wlr_drm_format_set_add(struct wlr_drm_format_set *set, uint32_t format,
 		set->formats = tmp;
 	}
 
-	set->formats[set->len++] = fmt;
+	size_t i = format_set_lower_bound(set, format);
+	memmove(&set->formats[i + 1], &set->formats[i],
+		(set->len - i) * sizeof(*set->formats));
+	set->formats[i] = fmt;
+	set->len++;
 	return true;
 }
 
@@ -113,10 +151,9 @@ bool wlr_drm_format_add(struct wlr_drm_format **fmt_ptr, uint64_t modifier) {
 		return true;
 	}
 
-	for (size_t i = 0; i < fmt->len; ++i) {
-		if (fmt->modifiers[i] == modifier) {
-			return true;
-		}
+	size_t i = format_lower_bound(fmt, modifier);
+	if (i < fmt->len && fmt->modifiers[i] == modifier) {
+		return true;
 	}
 
 	if (fmt->len == fmt->cap) {
@@ -132,7 +169,10 @@ bool wlr_drm_format_add(struct wlr_drm_format **fmt_ptr, uint64_t modifier) {
 		*fmt_ptr = fmt;
 	}
 
-	fmt->modifiers[fmt->len++] = modifier;
+	memmove(&fmt->modifiers[i + 1], &fmt->modifiers[i],
+		(fmt->len - i) * sizeof(fmt->modifiers[0]));
+	fmt->modifiers[i] = modifier;
+	fmt->len++;
 	return true;
 }
 
@@ -173,14 +213,19 @@ struct wlr_drm_format *wlr_drm_format_intersect(
 	format->format = a->format;
 	format->cap = format_cap;
 
-	for (size_t i = 0; i < a->len; i++) {
-		for (size_t j = 0; j < b->len; j++) {
-			if (a->modifiers[i] == b->modifiers[j]) {
-				assert(format->len < format->cap);
-				format->modifiers[format->len] = a->modifiers[i];
-				format->len++;
-				break;
-			}
+	// Both modifier lists are sorted, merge them
+	size_t i = 0, j = 0;
+	while (i < a->len && j < b->len) {
+		if (a->modifiers[i] < b->modifiers[j]) {
+			i++;
+		} else if (a->modifiers[i] > b->modifiers[j]) {
+			j++;
+		} else {
+			assert(format->len < format->cap);
+			format->modifiers[format->len] = a->modifiers[i];
+			format->len++;
+			i++;
+			j++;
 		}
 	}
 
@@ -20,13 +20,6 @@
 #include "types/wlr_buffer.h"
 #include "backend/drm/drm.h"
 
-static const GLfloat verts[] = {
-	1, 0, // top right
-	0, 0, // top left
-	1, 1, // bottom right
-	0, 1, // bottom left
-};
-
 static const struct wlr_renderer_impl renderer_impl;
 
 struct wlr_gles2_renderer *gles2_get_renderer(
@@ -160,6 +153,107 @@ error_buffer:
 	return NULL;
 }
 
+// Issues a GL call from a render pass, and counts it in the frame stats
+#define PASS_GL(renderer, call) \
+	do { \
+		(renderer)->stats.gl_calls++; \
+		call; \
+	} while (0)
+
+/**
+ * The program and vertex attrib arrays are only tracked when batching is
+ * enabled: otherwise, compositors may issue their own GL calls in the middle
+ * of a render pass, so the state can't be relied upon.
+ */
+static void use_program(struct wlr_gles2_renderer *renderer, GLuint program) {
+	if (renderer->batch.enabled && renderer->gl_state.program == program) {
+		return;
+	}
+	PASS_GL(renderer, glUseProgram(program));
+	renderer->gl_state.program = program;
+}
+
+static void set_attribs(struct wlr_gles2_renderer *renderer, uint32_t attribs) {
+	uint32_t changed = renderer->gl_state.attribs ^ attribs;
+	for (GLuint i = 0; changed != 0; i++, changed >>= 1) {
+		if (!(changed & 1)) {
+			continue;
+		}
+		if (attribs & (1u << i)) {
+			PASS_GL(renderer, glEnableVertexAttribArray(i));
+		} else {
+			PASS_GL(renderer, glDisableVertexAttribArray(i));
+		}
+	}
+	renderer->gl_state.attribs = attribs;
+}
+
+static uint32_t attrib_bit(GLint attrib) {
+	return attrib >= 0 && attrib < 32 ? 1u << attrib : 0;
+}
+
+void gles2_flush_batch(struct wlr_gles2_renderer *renderer) {
+	if (renderer->batch.n_quads == 0) {
+		return;
+	}
+
+	push_gles2_debug(renderer);
+
+	GLsizei n_verts = renderer->batch.n_quads * 6;
+	struct wlr_gles2_tex_shader *shader = renderer->batch.tex_shader;
+	if (shader != NULL) {
+		struct wlr_gles2_texture *texture = renderer->batch.texture;
+
+		PASS_GL(renderer, glActiveTexture(GL_TEXTURE0));
+		PASS_GL(renderer, glBindTexture(texture->target, texture->tex));
+		PASS_GL(renderer, glTexParameteri(texture->target,
+			GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+
+		use_program(renderer, shader->program);
+
+		PASS_GL(renderer, glUniform1i(shader->invert_y, texture->inverted_y));
+		PASS_GL(renderer, glUniform1f(shader->alpha, renderer->batch.alpha));
+
+		PASS_GL(renderer, glVertexAttribPointer(shader->pos_attrib, 2,
+			GL_FLOAT, GL_FALSE, 0, renderer->batch.pos));
+		PASS_GL(renderer, glVertexAttribPointer(shader->tex_attrib, 2,
+			GL_FLOAT, GL_FALSE, 0, renderer->batch.texcoord));
+
+		set_attribs(renderer, attrib_bit(shader->pos_attrib) |
+			attrib_bit(shader->tex_attrib));
+
+		PASS_GL(renderer, glDrawArrays(GL_TRIANGLES, 0, n_verts));
+
+		PASS_GL(renderer, glBindTexture(texture->target, 0));
+	} else {
+		const float *color = renderer->batch.color;
+
+		use_program(renderer, renderer->shaders.quad.program);
+
+		PASS_GL(renderer, glUniform4f(renderer->shaders.quad.color,
+			color[0], color[1], color[2], color[3]));
+
+		PASS_GL(renderer, glVertexAttribPointer(
+			renderer->shaders.quad.pos_attrib, 2, GL_FLOAT, GL_FALSE, 0,
+			renderer->batch.pos));
+
+		set_attribs(renderer, attrib_bit(renderer->shaders.quad.pos_attrib));
+
+		PASS_GL(renderer, glDrawArrays(GL_TRIANGLES, 0, n_verts));
+	}
+
+	if (!renderer->batch.enabled) {
+		// The compositor may change the GL state before the next draw
+		set_attribs(renderer, 0);
+	}
+
+	pop_gles2_debug(renderer);
+
+	renderer->batch.n_quads = 0;
+	renderer->batch.tex_shader = NULL;
+	renderer->batch.texture = NULL;
+}
+
 static bool gles2_bind_buffer(struct wlr_renderer *wlr_renderer,
 		struct wlr_buffer *wlr_buffer) {
 	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
@@ -167,6 +261,8 @@ static bool gles2_bind_buffer(struct wlr_renderer *wlr_renderer,
 	if (renderer->current_buffer != NULL) {
 		assert(wlr_egl_is_current(renderer->egl));
 
+		gles2_flush_batch(renderer);
+
 		push_gles2_debug(renderer);
 		glFlush();
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -211,7 +307,9 @@ static void gles2_begin(struct wlr_renderer *wlr_renderer, uint32_t width,
 
 	push_gles2_debug(renderer);
 
-	glViewport(0, 0, width, height);
+	renderer->stats.gl_calls = 0;
+
+	PASS_GL(renderer, glViewport(0, 0, width, height));
 	renderer->viewport_width = width;
 	renderer->viewport_height = height;
 
@@ -220,8 +318,8 @@ static void gles2_begin(struct wlr_renderer *wlr_renderer, uint32_t width,
 			WL_OUTPUT_TRANSFORM_NORMAL);
 
 	// enable transparency
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	PASS_GL(renderer, glEnable(GL_BLEND));
+	PASS_GL(renderer, glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
 
 	// XXX: maybe we should save output projection and remove some of the need
 	// for users to sling matricies themselves
@@ -231,20 +329,33 @@ static void gles2_begin(struct wlr_renderer *wlr_renderer, uint32_t width,
 
 static void gles2_end(struct wlr_renderer *wlr_renderer) {
 	struct wlr_gles2_renderer *renderer = gles2_get_renderer_in_context(wlr_renderer);
+
+	gles2_flush_batch(renderer);
+
+	// Leave the GL state as we found it, so that it can be tracked again from
+	// scratch in the next frame
+	push_gles2_debug(renderer);
+	set_attribs(renderer, 0);
+	use_program(renderer, 0);
+	pop_gles2_debug(renderer);
+
 	if(renderer->current_buffer && renderer->current_buffer->egl_stream_texture)
 	{
 		// Renders eglstream offscreen buffer
 		push_gles2_debug(renderer);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		PASS_GL(renderer, glBindFramebuffer(GL_FRAMEBUFFER, 0));
 
-		glViewport(0, 0, renderer->current_buffer->buffer->width,
-				renderer->current_buffer->buffer->height);
+		PASS_GL(renderer, glViewport(0, 0,
+			renderer->current_buffer->buffer->width,
+			renderer->current_buffer->buffer->height));
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, renderer->current_buffer->egl_stream_texture);
+		PASS_GL(renderer, glActiveTexture(GL_TEXTURE0));
+		PASS_GL(renderer, glBindTexture(GL_TEXTURE_2D,
+			renderer->current_buffer->egl_stream_texture));
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		PASS_GL(renderer, glTexParameteri(GL_TEXTURE_2D,
+			GL_TEXTURE_MIN_FILTER, GL_LINEAR));
 	
 		float gl_matrix[9];
 		wlr_matrix_identity(gl_matrix);
@@ -252,12 +363,13 @@ static void gles2_end(struct wlr_renderer *wlr_renderer) {
 		// OpenGL ES 2 requires the glUniformMatrix3fv transpose parameter to be set
 		// to GL_FALSE
 		struct wlr_gles2_tex_shader *shader = &renderer->shaders.tex_rgba;
-		glUseProgram(shader->program);
+		PASS_GL(renderer, glUseProgram(shader->program));
 
-		glUniformMatrix3fv(shader->proj, 1, GL_FALSE, gl_matrix);
-		glUniform1i(shader->invert_y, 1);
-		glUniform1i(shader->tex, 0);
-		glUniform1f(shader->alpha, 1.0f);
+		PASS_GL(renderer, glUniformMatrix3fv(shader->proj, 1, GL_FALSE,
+			gl_matrix));
+		PASS_GL(renderer, glUniform1i(shader->invert_y, 1));
+		PASS_GL(renderer, glUniform1i(shader->tex, 0));
+		PASS_GL(renderer, glUniform1f(shader->alpha, 1.0f));
 
 		const GLfloat egl_verts[] = {
 			1, -1, // top right
@@ -272,19 +384,21 @@ static void gles2_end(struct wlr_renderer *wlr_renderer) {
 			0, 1, // bottom left
 		};
 
-		glVertexAttribPointer(shader->pos_attrib, 2, GL_FLOAT, GL_FALSE, 0, egl_verts);
-		glVertexAttribPointer(shader->tex_attrib, 2, GL_FLOAT, GL_FALSE, 0, texcoord);
+		PASS_GL(renderer, glVertexAttribPointer(shader->pos_attrib, 2,
+			GL_FLOAT, GL_FALSE, 0, egl_verts));
+		PASS_GL(renderer, glVertexAttribPointer(shader->tex_attrib, 2,
+			GL_FLOAT, GL_FALSE, 0, texcoord));
 
-		glEnableVertexAttribArray(shader->pos_attrib);
-		glEnableVertexAttribArray(shader->tex_attrib);
+		PASS_GL(renderer, glEnableVertexAttribArray(shader->pos_attrib));
+		PASS_GL(renderer, glEnableVertexAttribArray(shader->tex_attrib));
 
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		PASS_GL(renderer, glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
 
-		glDisableVertexAttribArray(shader->pos_attrib);
-		glDisableVertexAttribArray(shader->tex_attrib);
+		PASS_GL(renderer, glDisableVertexAttribArray(shader->pos_attrib));
+		PASS_GL(renderer, glDisableVertexAttribArray(shader->tex_attrib));
 
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glUseProgram(0);
+		PASS_GL(renderer, glBindTexture(GL_TEXTURE_2D, 0));
+		PASS_GL(renderer, glUseProgram(0));
 
 		pop_gles2_debug(renderer);
 	}
@@ -297,9 +411,11 @@ static void gles2_clear(struct wlr_renderer *wlr_renderer,
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
 
+	gles2_flush_batch(renderer);
+
 	push_gles2_debug(renderer);
-	glClearColor(color[0], color[1], color[2], color[3]);
-	glClear(GL_COLOR_BUFFER_BIT);
+	PASS_GL(renderer, glClearColor(color[0], color[1], color[2], color[3]));
+	PASS_GL(renderer, glClear(GL_COLOR_BUFFER_BIT));
 	pop_gles2_debug(renderer);
 }
 
@@ -308,12 +424,14 @@ static void gles2_scissor(struct wlr_renderer *wlr_renderer,
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
 
+	gles2_flush_batch(renderer);
+
 	push_gles2_debug(renderer);
 	if (box != NULL) {
-		glScissor(box->x, box->y, box->width, box->height);
-		glEnable(GL_SCISSOR_TEST);
+		PASS_GL(renderer, glScissor(box->x, box->y, box->width, box->height));
+		PASS_GL(renderer, glEnable(GL_SCISSOR_TEST));
 	} else {
-		glDisable(GL_SCISSOR_TEST);
+		PASS_GL(renderer, glDisable(GL_SCISSOR_TEST));
 	}
 	pop_gles2_debug(renderer);
 }
@@ -324,6 +442,47 @@ static const float flip_180[9] = {
 	0.0f, 0.0f, 1.0f,
 };
 
+// Two triangles covering the unit square
+static const GLfloat verts[] = {
+	1, 0, // top right
+	0, 0, // top left
+	1, 1, // bottom right
+	0, 0, // top left
+	1, 1, // bottom right
+	0, 1, // bottom left
+};
+
+/**
+ * Appends the unit square transformed by the given matrix to the current
+ * batch, and returns a pointer to the quad's texture coordinates.
+ */
+static GLfloat *batch_add_quad(struct wlr_gles2_renderer *renderer,
+		const float matrix[static 9]) {
+	float gl_matrix[9];
+	wlr_matrix_multiply(gl_matrix, renderer->projection, matrix);
+	wlr_matrix_multiply(gl_matrix, flip_180, gl_matrix);
+
+	size_t offset = renderer->batch.n_quads * 12;
+	GLfloat *pos = &renderer->batch.pos[offset];
+	for (size_t i = 0; i < 12; i += 2) {
+		// Our matrices are affine, the last row is always (0, 0, 1)
+		pos[i] = gl_matrix[0] * verts[i] + gl_matrix[1] * verts[i + 1] +
+			gl_matrix[2];
+		pos[i + 1] = gl_matrix[3] * verts[i] + gl_matrix[4] * verts[i + 1] +
+			gl_matrix[5];
+	}
+
+	renderer->batch.n_quads++;
+	return &renderer->batch.texcoord[offset];
+}
+
+static void batch_end_quad(struct wlr_gles2_renderer *renderer) {
+	if (!renderer->batch.enabled ||
+			renderer->batch.n_quads == WLR_GLES2_BATCH_MAX_QUADS) {
+		gles2_flush_batch(renderer);
+	}
+}
+
 static bool gles2_render_subtexture_with_matrix(
 		struct wlr_renderer *wlr_renderer, struct wlr_texture *wlr_texture,
 		const struct wlr_fbox *box, const float matrix[static 9],
@@ -356,53 +515,32 @@ static bool gles2_render_subtexture_with_matrix(
 		abort();
 	}
 
-	float gl_matrix[9];
-	wlr_matrix_multiply(gl_matrix, renderer->projection, matrix);
-	wlr_matrix_multiply(gl_matrix, flip_180, gl_matrix);
-
-	// OpenGL ES 2 requires the glUniformMatrix3fv transpose parameter to be set
-	// to GL_FALSE
-	wlr_matrix_transpose(gl_matrix, gl_matrix);
-
-	push_gles2_debug(renderer);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(texture->target, texture->tex);
-
-	glTexParameteri(texture->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-	glUseProgram(shader->program);
+	if (renderer->batch.tex_shader != shader ||
+			renderer->batch.texture != texture ||
+			renderer->batch.alpha != alpha) {
+		gles2_flush_batch(renderer);
+		renderer->batch.tex_shader = shader;
+		renderer->batch.texture = texture;
+		renderer->batch.alpha = alpha;
+	}
 
-	glUniformMatrix3fv(shader->proj, 1, GL_FALSE, gl_matrix);
-	glUniform1i(shader->invert_y, texture->inverted_y);
-	glUniform1i(shader->tex, 0);
-	glUniform1f(shader->alpha, alpha);
+	GLfloat *texcoord = batch_add_quad(renderer, matrix);
 
 	const GLfloat x1 = box->x / wlr_texture->width;
 	const GLfloat y1 = box->y / wlr_texture->height;
 	const GLfloat x2 = (box->x + box->width) / wlr_texture->width;
 	const GLfloat y2 = (box->y + box->height) / wlr_texture->height;
-	const GLfloat texcoord[] = {
+	const GLfloat quad_texcoord[] = {
 		x2, y1, // top right
 		x1, y1, // top left
 		x2, y2, // bottom right
+		x1, y1, // top left
+		x2, y2, // bottom right
 		x1, y2, // bottom left
 	};
+	memcpy(texcoord, quad_texcoord, sizeof(quad_texcoord));
 
-	glVertexAttribPointer(shader->pos_attrib, 2, GL_FLOAT, GL_FALSE, 0, verts);
-	glVertexAttribPointer(shader->tex_attrib, 2, GL_FLOAT, GL_FALSE, 0, texcoord);
-
-	glEnableVertexAttribArray(shader->pos_attrib);
-	glEnableVertexAttribArray(shader->tex_attrib);
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-	glDisableVertexAttribArray(shader->pos_attrib);
-	glDisableVertexAttribArray(shader->tex_attrib);
-
-	glBindTexture(texture->target, 0);
-
-	pop_gles2_debug(renderer);
+	batch_end_quad(renderer);
 	return true;
 }
 
@@ -411,30 +549,15 @@ static void gles2_render_quad_with_matrix(struct wlr_renderer *wlr_renderer,
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
 
-	float gl_matrix[9];
-	wlr_matrix_multiply(gl_matrix, renderer->projection, matrix);
-	wlr_matrix_multiply(gl_matrix, flip_180, gl_matrix);
-
-	// OpenGL ES 2 requires the glUniformMatrix3fv transpose parameter to be set
-	// to GL_FALSE
-	wlr_matrix_transpose(gl_matrix, gl_matrix);
-
-	push_gles2_debug(renderer);
-	glUseProgram(renderer->shaders.quad.program);
-
-	glUniformMatrix3fv(renderer->shaders.quad.proj, 1, GL_FALSE, gl_matrix);
-	glUniform4f(renderer->shaders.quad.color, color[0], color[1], color[2], color[3]);
-
-	glVertexAttribPointer(renderer->shaders.quad.pos_attrib, 2, GL_FLOAT, GL_FALSE,
-			0, verts);
-
-	glEnableVertexAttribArray(renderer->shaders.quad.pos_attrib);
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-	glDisableVertexAttribArray(renderer->shaders.quad.pos_attrib);
+	if (renderer->batch.n_quads > 0 && (renderer->batch.tex_shader != NULL ||
+			memcmp(renderer->batch.color, color,
+				sizeof(renderer->batch.color)) != 0)) {
+		gles2_flush_batch(renderer);
+	}
+	memcpy(renderer->batch.color, color, sizeof(renderer->batch.color));
 
-	pop_gles2_debug(renderer);
+	batch_add_quad(renderer, matrix);
+	batch_end_quad(renderer);
 }
 
 static const uint32_t *gles2_get_shm_texture_formats(
@@ -537,6 +660,8 @@ static bool gles2_read_pixels(struct wlr_renderer *wlr_renderer,
 		drm_get_pixel_format_info(fmt->drm_format);
 	assert(drm_fmt);
 
+	gles2_flush_batch(renderer);
+
 	push_gles2_debug(renderer);
 
 	// Make sure any pending drawing is finished before we try to read it
@@ -571,6 +696,264 @@ static bool gles2_read_pixels(struct wlr_renderer *wlr_renderer,
 	return glGetError() == GL_NO_ERROR;
 }
 
+// GLES 3.0 tokens, missing from the GLES2 headers
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_TIMEOUT_IGNORED
+#define GL_TIMEOUT_IGNORED 0xFFFFFFFFFFFFFFFFull
+#endif
+
+static const struct wlr_renderer_readback_impl readback_impl;
+
+static struct wlr_gles2_readback *gles2_get_readback(
+		struct wlr_renderer_readback *wlr_readback) {
+	assert(wlr_readback->impl == &readback_impl);
+	return (struct wlr_gles2_readback *)wlr_readback;
+}
+
+static void gles2_readback_release(struct wlr_gles2_readback *readback) {
+	struct wlr_gles2_renderer *renderer = readback->renderer;
+	if (renderer == NULL) {
+		return;
+	}
+
+	struct wlr_egl_context prev_ctx;
+	wlr_egl_save_context(&prev_ctx);
+	wlr_egl_make_current(renderer->egl);
+
+	renderer->procs.glDeleteSync(readback->sync);
+	glDeleteBuffers(1, &readback->pbo);
+
+	wlr_egl_restore_context(&prev_ctx);
+
+	wl_list_remove(&readback->link);
+	readback->renderer = NULL;
+}
+
+static bool gles2_readback_is_ready(struct wlr_renderer_readback *wlr_readback) {
+	struct wlr_gles2_readback *readback = gles2_get_readback(wlr_readback);
+	struct wlr_gles2_renderer *renderer = readback->renderer;
+	if (renderer == NULL) {
+		// finish will fail right away
+		return true;
+	}
+
+	struct wlr_egl_context prev_ctx;
+	wlr_egl_save_context(&prev_ctx);
+	wlr_egl_make_current(renderer->egl);
+
+	GLenum status = renderer->procs.glClientWaitSync(readback->sync,
+		GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+	wlr_egl_restore_context(&prev_ctx);
+
+	return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+static bool gles2_readback_finish(struct wlr_renderer_readback *wlr_readback,
+		uint32_t *flags, uint32_t stride, uint32_t dst_x, uint32_t dst_y,
+		void *data) {
+	struct wlr_gles2_readback *readback = gles2_get_readback(wlr_readback);
+	struct wlr_gles2_renderer *renderer = readback->renderer;
+	if (renderer == NULL) {
+		return false;
+	}
+
+	const struct wlr_pixel_format_info *drm_fmt =
+		drm_get_pixel_format_info(readback->fmt->drm_format);
+	assert(drm_fmt);
+	uint32_t pack_stride = readback->base.width * drm_fmt->bpp / 8;
+	size_t size = (size_t)pack_stride * readback->base.height;
+
+	struct wlr_egl_context prev_ctx;
+	wlr_egl_save_context(&prev_ctx);
+	wlr_egl_make_current(renderer->egl);
+
+	push_gles2_debug(renderer);
+
+	// No-op if the read-back already completed
+	renderer->procs.glClientWaitSync(readback->sync,
+		GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+	const unsigned char *src = renderer->procs.glMapBufferRange(
+		GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+	bool ok = src != NULL;
+	if (ok) {
+		unsigned char *p = (unsigned char *)data + dst_y * stride +
+			dst_x * drm_fmt->bpp / 8;
+		if (pack_stride == stride && dst_x == 0) {
+			memcpy(p, src, size);
+		} else {
+			for (size_t i = 0; i < readback->base.height; ++i) {
+				memcpy(p + i * stride, src + i * pack_stride, pack_stride);
+			}
+		}
+		renderer->procs.glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	} else {
+		wlr_log(WLR_ERROR, "Failed to map pixel buffer object");
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	pop_gles2_debug(renderer);
+
+	wlr_egl_restore_context(&prev_ctx);
+
+	if (flags != NULL) {
+		*flags = readback->flags;
+	}
+
+	return ok;
+}
+
+static void gles2_readback_destroy(struct wlr_renderer_readback *wlr_readback) {
+	struct wlr_gles2_readback *readback = gles2_get_readback(wlr_readback);
+	gles2_readback_release(readback);
+	if (readback->fence_fd >= 0) {
+		close(readback->fence_fd);
+	}
+	free(readback);
+}
+
+static int gles2_readback_get_fence_fd(
+		struct wlr_renderer_readback *wlr_readback) {
+	struct wlr_gles2_readback *readback = gles2_get_readback(wlr_readback);
+	return readback->fence_fd;
+}
+
+static const struct wlr_renderer_readback_impl readback_impl = {
+	.is_ready = gles2_readback_is_ready,
+	.finish = gles2_readback_finish,
+	.destroy = gles2_readback_destroy,
+	.get_fence_fd = gles2_readback_get_fence_fd,
+};
+
+/**
+ * Inserts a native fence in the command stream, to be exported with
+ * gles2_export_native_fence once flushed. Returns EGL_NO_SYNC_KHR if native
+ * fences are unsupported.
+ */
+static EGLSyncKHR gles2_create_native_fence(
+		struct wlr_gles2_renderer *renderer) {
+	struct wlr_egl *egl = renderer->egl;
+	if (!egl->exts.native_fence_sync_android) {
+		return EGL_NO_SYNC_KHR;
+	}
+	return egl->procs.eglCreateSyncKHR(egl->display,
+		EGL_SYNC_NATIVE_FENCE_ANDROID, NULL);
+}
+
+/**
+ * Exports the fence as a sync file FD and destroys it. Returns -1 on failure.
+ */
+static int gles2_export_native_fence(struct wlr_gles2_renderer *renderer,
+		EGLSyncKHR sync) {
+	struct wlr_egl *egl = renderer->egl;
+	if (sync == EGL_NO_SYNC_KHR) {
+		return -1;
+	}
+	// Only valid once the fence has been flushed
+	int fd = egl->procs.eglDupNativeFenceFDANDROID(egl->display, sync);
+	egl->procs.eglDestroySyncKHR(egl->display, sync);
+	return fd == EGL_NO_NATIVE_FENCE_FD_ANDROID ? -1 : fd;
+}
+
+static struct wlr_renderer_readback *gles2_read_pixels_async(
+		struct wlr_renderer *wlr_renderer, uint32_t drm_format,
+		uint32_t width, uint32_t height, uint32_t src_x, uint32_t src_y) {
+	struct wlr_gles2_renderer *renderer =
+		gles2_get_renderer_in_context(wlr_renderer);
+
+	if (!renderer->exts.pbo) {
+		return NULL;
+	}
+
+	const struct wlr_gles2_pixel_format *fmt =
+		get_gles2_format_from_drm(drm_format);
+	if (fmt == NULL) {
+		wlr_log(WLR_ERROR, "Cannot read pixels: unsupported pixel format");
+		return NULL;
+	}
+
+	if (fmt->gl_format == GL_BGRA_EXT && !renderer->exts.read_format_bgra_ext) {
+		wlr_log(WLR_ERROR,
+			"Cannot read pixels: missing GL_EXT_read_format_bgra extension");
+		return NULL;
+	}
+
+	const struct wlr_pixel_format_info *drm_fmt =
+		drm_get_pixel_format_info(fmt->drm_format);
+	assert(drm_fmt);
+
+	struct wlr_gles2_readback *readback = calloc(1, sizeof(*readback));
+	if (readback == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	wlr_renderer_readback_init(&readback->base, &readback_impl, drm_format,
+		width, height);
+	readback->renderer = renderer;
+	readback->fmt = fmt;
+	readback->fence_fd = -1;
+	readback->flags = renderer->current_buffer->egl_stream_texture ?
+		WLR_RENDERER_READ_PIXELS_Y_INVERT : 0;
+
+	gles2_flush_batch(renderer);
+
+	push_gles2_debug(renderer);
+
+	glGetError(); // Clear the error flag
+
+	// The copy into the PBO is queued on the GPU, glReadPixels doesn't wait
+	// for pending drawing to complete
+	glGenBuffers(1, &readback->pbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+	glBufferData(GL_PIXEL_PACK_BUFFER,
+		(GLsizeiptr)width * height * drm_fmt->bpp / 8, NULL, GL_STREAM_READ);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(src_x, src_y, width, height, fmt->gl_format, fmt->gl_type,
+		NULL);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readback->sync =
+		renderer->procs.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	EGLSyncKHR native_fence = gles2_create_native_fence(renderer);
+	glFlush();
+	readback->fence_fd = gles2_export_native_fence(renderer, native_fence);
+
+	pop_gles2_debug(renderer);
+
+	wl_list_insert(&renderer->readbacks, &readback->link);
+
+	if (glGetError() != GL_NO_ERROR || readback->sync == NULL) {
+		wlr_log(WLR_ERROR, "Failed to start asynchronous read-back");
+		gles2_readback_destroy(&readback->base);
+		return NULL;
+	}
+
+	return &readback->base;
+}
+
 static bool gles2_init_wl_display(struct wlr_renderer *wlr_renderer,
 		struct wl_display *wl_display) {
 	struct wlr_gles2_renderer *renderer =
@@ -630,6 +1013,12 @@ static void gles2_destroy(struct wlr_renderer *wlr_renderer) {
 		gles2_texture_destroy(tex);
 	}
 
+	// Read-backs are owned by their users, only release the GL objects
+	struct wlr_gles2_readback *readback, *readback_tmp;
+	wl_list_for_each_safe(readback, readback_tmp, &renderer->readbacks, link) {
+		gles2_readback_release(readback);
+	}
+
 	push_gles2_debug(renderer);
 	glDeleteProgram(renderer->shaders.quad.program);
 	glDeleteProgram(renderer->shaders.tex_rgba.program);
@@ -676,7 +1065,8 @@ static const struct wlr_renderer_impl renderer_impl = {
 	.get_render_buffer_caps = gles2_get_render_buffer_caps,
 	.texture_from_buffer = gles2_texture_from_buffer,
 	.texture_from_wl_eglstream = gles2_texture_from_wl_eglstream,
-	.get_egl = gles2_renderer_get_egl
+	.get_egl = gles2_renderer_get_egl,
+	.read_pixels_async = gles2_read_pixels_async,
 };
 
 void push_gles2_debug_(struct wlr_gles2_renderer *renderer,
@@ -868,12 +1258,16 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 
 	wl_list_init(&renderer->buffers);
 	wl_list_init(&renderer->textures);
+	wl_list_init(&renderer->readbacks);
 	wl_list_init(&renderer->client_streams);
 
 	renderer->egl = egl;
 	renderer->exts_str = exts_str;
 	renderer->drm_fd = -1;
 
+	const char *batch = getenv("WLR_GLES2_BATCH");
+	renderer->batch.enabled = batch != NULL && strcmp(batch, "1") == 0;
+
 	wlr_log(WLR_INFO, "Creating GLES2 renderer");
 	wlr_log(WLR_INFO, "Using %s", glGetString(GL_VERSION));
 	wlr_log(WLR_INFO, "GL vendor: %s", glGetString(GL_VENDOR));
@@ -897,6 +1291,20 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 	renderer->exts.read_format_bgra_ext =
 		check_gl_ext(exts_str, "GL_EXT_read_format_bgra");
 
+	// Drivers usually hand out a GLES 3 context even though we ask for GLES 2
+	int gles_major = 0;
+	const char *gl_version = (const char *)glGetString(GL_VERSION);
+	if (gl_version != NULL &&
+			sscanf(gl_version, "OpenGL ES %d", &gles_major) == 1 &&
+			gles_major >= 3) {
+		renderer->exts.pbo = true;
+		load_gl_proc(&renderer->procs.glMapBufferRange, "glMapBufferRange");
+		load_gl_proc(&renderer->procs.glUnmapBuffer, "glUnmapBuffer");
+		load_gl_proc(&renderer->procs.glFenceSync, "glFenceSync");
+		load_gl_proc(&renderer->procs.glClientWaitSync, "glClientWaitSync");
+		load_gl_proc(&renderer->procs.glDeleteSync, "glDeleteSync");
+	}
+
 	if (check_gl_ext(exts_str, "GL_KHR_debug")) {
 		renderer->exts.debug_khr = true;
 		load_gl_proc(&renderer->procs.glDebugMessageCallbackKHR,
@@ -979,6 +1387,30 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 		renderer->shaders.tex_ext.tex_attrib = glGetAttribLocation(prog, "texcoord");
 	}
 
+	// Vertices are transformed on the CPU, and all textures are bound to the
+	// first texture unit
+	const float identity[9] = {
+		1.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 1.0f,
+	};
+	glUseProgram(renderer->shaders.quad.program);
+	glUniformMatrix3fv(renderer->shaders.quad.proj, 1, GL_FALSE, identity);
+	struct wlr_gles2_tex_shader *tex_shaders[] = {
+		&renderer->shaders.tex_rgba,
+		&renderer->shaders.tex_rgbx,
+		&renderer->shaders.tex_ext,
+	};
+	for (size_t i = 0; i < sizeof(tex_shaders) / sizeof(tex_shaders[0]); i++) {
+		if (tex_shaders[i]->program == 0) {
+			continue;
+		}
+		glUseProgram(tex_shaders[i]->program);
+		glUniformMatrix3fv(tex_shaders[i]->proj, 1, GL_FALSE, identity);
+		glUniform1i(tex_shaders[i]->tex, 0);
+	}
+	glUseProgram(0);
+
 	pop_gles2_debug(renderer);
 
 	wlr_egl_unset_current(renderer->egl);
@@ -1009,3 +1441,8 @@ bool wlr_gles2_renderer_check_ext(struct wlr_renderer *wlr_renderer,
 	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
 	return check_gl_ext(renderer->exts_str, ext);
 }
+
+uint32_t wlr_gles2_renderer_get_gl_call_count(struct wlr_renderer *wlr_renderer) {
+	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
+	return renderer->stats.gl_calls;
+}
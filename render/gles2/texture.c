@@ -33,6 +33,16 @@ static bool gles2_texture_is_opaque(struct wlr_texture *wlr_texture) {
 	return !texture->has_alpha;
 }
 
+/**
+ * Submits the renderer's pending draws if they sample from the texture, so
+ * that they are not affected by changes made to the texture afterwards.
+ */
+static void flush_texture_batch(struct wlr_gles2_texture *texture) {
+	if (texture->renderer->batch.texture == texture) {
+		gles2_flush_batch(texture->renderer);
+	}
+}
+
 static bool check_stride(const struct wlr_pixel_format_info *fmt,
 		uint32_t stride, uint32_t width) {
 	if (stride % (fmt->bpp / 8) != 0) {
@@ -75,6 +85,8 @@ static bool gles2_texture_write_pixels(struct wlr_texture *wlr_texture,
 	wlr_egl_save_context(&prev_ctx);
 	wlr_egl_make_current(texture->renderer->egl);
 
+	flush_texture_batch(texture);
+
 	push_gles2_debug(texture->renderer);
 
 	glBindTexture(GL_TEXTURE_2D, texture->tex);
@@ -112,6 +124,8 @@ static bool gles2_texture_invalidate(struct wlr_gles2_texture *texture) {
 	wlr_egl_save_context(&prev_ctx);
 	wlr_egl_make_current(texture->renderer->egl);
 
+	flush_texture_batch(texture);
+
 	push_gles2_debug(texture->renderer);
 
 	glBindTexture(texture->target, texture->tex);
@@ -134,6 +148,8 @@ void gles2_texture_destroy(struct wlr_gles2_texture *texture) {
 	wlr_egl_save_context(&prev_ctx);
 	wlr_egl_make_current(texture->renderer->egl);
 
+	flush_texture_batch(texture);
+
 	push_gles2_debug(texture->renderer);
 	if (!texture->stream) {
 		glDeleteTextures(1, &texture->tex);
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <drm_fourcc.h>
+#include <math.h>
 #include <pixman.h>
 #include <stdlib.h>
 #include <wayland-server.h>
@@ -39,7 +40,7 @@ static struct wlr_pixman_texture *get_texture(
 
 static bool texture_is_opaque(struct wlr_texture *wlr_texture) {
 	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
-	return texture->format_info->has_alpha;
+	return !texture->format_info->has_alpha;
 }
 
 static void texture_destroy(struct wlr_texture *wlr_texture) {
@@ -122,6 +123,47 @@ error_buffer:
 	return NULL;
 }
 
+static struct pixman_color color_to_pixman(const float color[static 4]) {
+	return (struct pixman_color){
+		.red = color[0] * 0xFFFF,
+		.green = color[1] * 0xFFFF,
+		.blue = color[2] * 0xFFFF,
+		.alpha = color[3] * 0xFFFF,
+	};
+}
+
+/**
+ * Returns a solid-fill image for the color. The image is owned by the
+ * renderer's cache and must not be unreferenced by the caller.
+ */
+static pixman_image_t *get_solid_fill(struct wlr_pixman_renderer *renderer,
+		const struct pixman_color *color) {
+	for (size_t i = 0; i < WLR_PIXMAN_SOLID_FILL_CACHE_SIZE; i++) {
+		struct wlr_pixman_solid_fill *fill = &renderer->solid_fills[i];
+		if (fill->image != NULL &&
+				memcmp(&fill->color, color, sizeof(*color)) == 0) {
+			return fill->image;
+		}
+	}
+
+	pixman_image_t *image = pixman_image_create_solid_fill(color);
+	if (image == NULL) {
+		return NULL;
+	}
+
+	struct wlr_pixman_solid_fill *fill =
+		&renderer->solid_fills[renderer->solid_fills_next];
+	if (fill->image != NULL) {
+		pixman_image_unref(fill->image);
+	}
+	fill->color = *color;
+	fill->image = image;
+	renderer->solid_fills_next =
+		(renderer->solid_fills_next + 1) % WLR_PIXMAN_SOLID_FILL_CACHE_SIZE;
+
+	return image;
+}
+
 static void pixman_begin(struct wlr_renderer *wlr_renderer, uint32_t width,
 		uint32_t height) {
 	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
@@ -161,19 +203,15 @@ static void pixman_clear(struct wlr_renderer *wlr_renderer,
 	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
 	struct wlr_pixman_buffer *buffer = renderer->current_buffer;
 
-	const struct pixman_color colour = {
-		.red = color[0] * 0xFFFF,
-		.green = color[1] * 0xFFFF,
-		.blue = color[2] * 0xFFFF,
-		.alpha = color[3] * 0xFFFF,
-	};
+	const struct pixman_color colour = color_to_pixman(color);
 
-	pixman_image_t *fill = pixman_image_create_solid_fill(&colour);
+	pixman_image_t *fill = get_solid_fill(renderer, &colour);
+	if (fill == NULL) {
+		return;
+	}
 
 	pixman_image_composite32(PIXMAN_OP_SRC, fill, NULL, buffer->image, 0, 0, 0,
 			0, 0, 0, renderer->width, renderer->height);
-
-	pixman_image_unref(fill);
 }
 
 static void pixman_scissor(struct wlr_renderer *wlr_renderer,
@@ -181,7 +219,10 @@ static void pixman_scissor(struct wlr_renderer *wlr_renderer,
 	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
 	struct wlr_pixman_buffer *buffer = renderer->current_buffer;
 
+	renderer->has_scissor = box != NULL;
 	if (box != NULL) {
+		renderer->scissor = *box;
+
 		struct pixman_region32 region = {0};
 		pixman_region32_init_rect(&region, box->x, box->y, box->width,
 				box->height);
@@ -208,6 +249,61 @@ static void matrix_to_pixman_transform(struct pixman_transform *transform,
 	pixman_transform_from_pixman_f_transform(transform, &ftr);
 }
 
+/**
+ * Computes the area of the render target covered by the unit square
+ * transformed by the matrix, clipped to the render target and the scissor
+ * box. Returns false if nothing would be drawn.
+ */
+static bool get_dest_box(struct wlr_pixman_renderer *renderer,
+		const float matrix[static 9], struct wlr_box *dest) {
+	const float corners[4][2] = { {0, 0}, {1, 0}, {0, 1}, {1, 1} };
+	float x1 = INFINITY, y1 = INFINITY, x2 = -INFINITY, y2 = -INFINITY;
+	for (size_t i = 0; i < 4; i++) {
+		float x = matrix[0] * corners[i][0] + matrix[1] * corners[i][1] +
+			matrix[2];
+		float y = matrix[3] * corners[i][0] + matrix[4] * corners[i][1] +
+			matrix[5];
+		x1 = fminf(x1, x);
+		y1 = fminf(y1, y);
+		x2 = fmaxf(x2, x);
+		y2 = fmaxf(y2, y);
+	}
+
+	struct wlr_box box = {
+		.x = floorf(x1),
+		.y = floorf(y1),
+	};
+	box.width = ceilf(x2) - box.x;
+	box.height = ceilf(y2) - box.y;
+
+	struct wlr_box target = {
+		.width = renderer->width,
+		.height = renderer->height,
+	};
+	if (!wlr_box_intersection(dest, &box, &target)) {
+		return false;
+	}
+	if (renderer->has_scissor &&
+			!wlr_box_intersection(dest, dest, &renderer->scissor)) {
+		return false;
+	}
+	return true;
+}
+
+static bool is_integer(float f) {
+	return floorf(f) == f;
+}
+
+/**
+ * Checks whether the matrix maps the unit square to a rectangle whose edges
+ * fall exactly on pixel boundaries, without rotation.
+ */
+static bool matrix_is_pixel_aligned(const float mat[static 9]) {
+	return mat[1] == 0.0 && mat[3] == 0.0 &&
+		is_integer(mat[0]) && is_integer(mat[4]) &&
+		is_integer(mat[2]) && is_integer(mat[5]);
+}
+
 static bool pixman_render_subtexture_with_matrix(
 		struct wlr_renderer *wlr_renderer, struct wlr_texture *wlr_texture,
 		const struct wlr_fbox *fbox, const float matrix[static 9],
@@ -216,6 +312,11 @@ static bool pixman_render_subtexture_with_matrix(
 	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
 	struct wlr_pixman_buffer *buffer = renderer->current_buffer;
 
+	struct wlr_box dest;
+	if (!get_dest_box(renderer, matrix, &dest)) {
+		return true;
+	}
+
 	if (texture->buffer != NULL) {
 		void *data;
 		uint32_t drm_format;
@@ -238,10 +339,19 @@ static bool pixman_render_subtexture_with_matrix(
 		}
 	}
 
-	// TODO: don't create a mask if alpha == 1.0
-	struct pixman_color mask_colour = {0};
-	mask_colour.alpha = 0xFFFF * alpha;
-	pixman_image_t *mask = pixman_image_create_solid_fill(&mask_colour);
+	pixman_image_t *mask = NULL;
+	if (alpha < 1.0) {
+		struct pixman_color mask_colour = {0};
+		mask_colour.alpha = 0xFFFF * alpha;
+		mask = get_solid_fill(renderer, &mask_colour);
+	}
+
+	// Opaque textures covering whole pixels can be copied without blending
+	pixman_op_t op = PIXMAN_OP_OVER;
+	if (mask == NULL && !texture->format_info->has_alpha &&
+			matrix_is_pixel_aligned(matrix)) {
+		op = PIXMAN_OP_SRC;
+	}
 
 	float m[9];
 	memcpy(m, matrix, sizeof(m));
@@ -253,17 +363,16 @@ static bool pixman_render_subtexture_with_matrix(
 
 	pixman_image_set_transform(texture->image, &transform);
 
-	// TODO clip properly with src_x and src_y
-	pixman_image_composite32(PIXMAN_OP_OVER, texture->image, mask,
-			buffer->image, 0, 0, 0, 0, 0, 0, renderer->width,
-			renderer->height);
+	// The transform maps destination coordinates to source coordinates, so
+	// the source origin is the same as the destination origin
+	pixman_image_composite32(op, texture->image, mask,
+			buffer->image, dest.x, dest.y, 0, 0, dest.x, dest.y, dest.width,
+			dest.height);
 
 	if (texture->buffer != NULL) {
 		buffer_end_data_ptr_access(texture->buffer);
 	}
 
-	pixman_image_unref(mask);
-
 	return true;
 }
 
@@ -272,14 +381,38 @@ static void pixman_render_quad_with_matrix(struct wlr_renderer *wlr_renderer,
 	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
 	struct wlr_pixman_buffer *buffer = renderer->current_buffer;
 
-	struct pixman_color colour = {
-		.red = color[0] * 0xFFFF,
-		.green = color[1] * 0xFFFF,
-		.blue = color[2] * 0xFFFF,
-		.alpha = color[3] * 0xFFFF,
-	};
+	struct wlr_box dest;
+	if (!get_dest_box(renderer, matrix, &dest)) {
+		return;
+	}
 
-	pixman_image_t *fill = pixman_image_create_solid_fill(&colour);
+	struct pixman_color colour = color_to_pixman(color);
+
+	if (colour.alpha == 0xFFFF && matrix_is_pixel_aligned(matrix)) {
+		// Opaque rectangles are filled directly. The destination box is
+		// already clipped to the scissor box, which matters because
+		// pixman_image_fill_boxes may ignore the clip region.
+		pixman_box32_t box = {
+			.x1 = dest.x,
+			.y1 = dest.y,
+			.x2 = dest.x + dest.width,
+			.y2 = dest.y + dest.height,
+		};
+		pixman_image_fill_boxes(PIXMAN_OP_SRC, buffer->image, &colour, 1, &box);
+		return;
+	}
+
+	pixman_image_t *fill = get_solid_fill(renderer, &colour);
+	if (fill == NULL) {
+		return;
+	}
+
+	if (matrix_is_pixel_aligned(matrix)) {
+		// Translucent rectangles are blended without an intermediate image
+		pixman_image_composite32(PIXMAN_OP_OVER, fill, NULL, buffer->image,
+			0, 0, 0, 0, dest.x, dest.y, dest.width, dest.height);
+		return;
+	}
 
 	float m[9];
 	memcpy(m, matrix, sizeof(m));
@@ -298,11 +431,12 @@ static void pixman_render_quad_with_matrix(struct wlr_renderer *wlr_renderer,
 
 	pixman_image_t *image = pixman_image_create_bits(PIXMAN_a8r8g8b8, width,
 			height, NULL, 0);
+	if (image == NULL) {
+		return;
+	}
 
-	// TODO find a way to fill the image without allocating 2 images
 	pixman_image_composite32(PIXMAN_OP_SRC, fill, NULL, image,
 		0, 0, 0, 0, 0, 0, width, height);
-	pixman_image_unref(fill);
 
 	struct pixman_transform transform = {0};
 	matrix_to_pixman_transform(&transform, m);
@@ -311,7 +445,7 @@ static void pixman_render_quad_with_matrix(struct wlr_renderer *wlr_renderer,
 	pixman_image_set_transform(image, &transform);
 
 	pixman_image_composite32(PIXMAN_OP_OVER, image, NULL, buffer->image,
-			0, 0, 0, 0, 0, 0, renderer->width, renderer->height);
+			dest.x, dest.y, 0, 0, dest.x, dest.y, dest.width, dest.height);
 
 	pixman_image_unref(image);
 }
@@ -466,6 +600,12 @@ static void pixman_destroy(struct wlr_renderer *wlr_renderer) {
 		wlr_texture_destroy(&tex->wlr_texture);
 	}
 
+	for (size_t i = 0; i < WLR_PIXMAN_SOLID_FILL_CACHE_SIZE; i++) {
+		if (renderer->solid_fills[i].image != NULL) {
+			pixman_image_unref(renderer->solid_fills[i].image);
+		}
+	}
+
 	wlr_drm_format_set_finish(&renderer->drm_formats);
 
 	free(renderer);
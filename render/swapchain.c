@@ -15,7 +15,10 @@ static void swapchain_handle_allocator_destroy(struct wl_listener *listener,
 
 struct wlr_swapchain *wlr_swapchain_create(
 		struct wlr_allocator *alloc, int width, int height,
-		const struct wlr_drm_format *format, void *backend_data) {
+		const struct wlr_drm_format *format, size_t depth,
+		void *backend_data) {
+	assert(depth <= WLR_SWAPCHAIN_CAP);
+
 	struct wlr_swapchain *swapchain = calloc(1, sizeof(*swapchain));
 	if (swapchain == NULL) {
 		return NULL;
@@ -24,6 +27,7 @@ struct wlr_swapchain *wlr_swapchain_create(
 	swapchain->width = width;
 	swapchain->height = height;
 	swapchain->backend_data = backend_data;
+	swapchain->depth = depth != 0 ? depth : WLR_SWAPCHAIN_CAP;
 
 	swapchain->format = wlr_drm_format_dup(format);
 	if (swapchain->format == NULL) {
@@ -84,7 +88,7 @@ static struct wlr_buffer *slot_acquire(struct wlr_swapchain *swapchain,
 struct wlr_buffer *wlr_swapchain_acquire(struct wlr_swapchain *swapchain,
 		int *age) {
 	struct wlr_swapchain_slot *free_slot = NULL;
-	for (size_t i = 0; i < WLR_SWAPCHAIN_CAP; i++) {
+	for (size_t i = 0; i < swapchain->depth; i++) {
 		struct wlr_swapchain_slot *slot = &swapchain->slots[i];
 		if (slot->acquired) {
 			continue;
@@ -95,7 +99,8 @@ struct wlr_buffer *wlr_swapchain_acquire(struct wlr_swapchain *swapchain,
 		free_slot = slot;
 	}
 	if (free_slot == NULL) {
-		wlr_log(WLR_ERROR, "No free output buffer slot");
+		wlr_log(WLR_ERROR, "No free output buffer slot (%zu in use)",
+			swapchain->depth);
 		return NULL;
 	}
 
@@ -111,6 +116,7 @@ struct wlr_buffer *wlr_swapchain_acquire(struct wlr_swapchain *swapchain,
 		wlr_log(WLR_ERROR, "Failed to allocate buffer");
 		return NULL;
 	}
+	swapchain->allocations++;
 	return slot_acquire(swapchain, free_slot, age);
 }
 
@@ -207,6 +207,52 @@ bool wlr_renderer_read_pixels(struct wlr_renderer *r, uint32_t fmt,
 		src_x, src_y, dst_x, dst_y, data);
 }
 
+void wlr_renderer_readback_init(struct wlr_renderer_readback *readback,
+		const struct wlr_renderer_readback_impl *impl, uint32_t format,
+		uint32_t width, uint32_t height) {
+	assert(impl->is_ready);
+	assert(impl->finish);
+	assert(impl->destroy);
+
+	readback->impl = impl;
+	readback->format = format;
+	readback->width = width;
+	readback->height = height;
+}
+
+struct wlr_renderer_readback *wlr_renderer_read_pixels_async(
+		struct wlr_renderer *r, uint32_t fmt, uint32_t width, uint32_t height,
+		uint32_t src_x, uint32_t src_y) {
+	if (!r->impl->read_pixels_async) {
+		return NULL;
+	}
+	return r->impl->read_pixels_async(r, fmt, width, height, src_x, src_y);
+}
+
+bool wlr_renderer_readback_is_ready(struct wlr_renderer_readback *readback) {
+	return readback->impl->is_ready(readback);
+}
+
+int wlr_renderer_readback_get_fence_fd(struct wlr_renderer_readback *readback) {
+	if (!readback->impl->get_fence_fd) {
+		return -1;
+	}
+	return readback->impl->get_fence_fd(readback);
+}
+
+bool wlr_renderer_readback_finish(struct wlr_renderer_readback *readback,
+		uint32_t *flags, uint32_t stride, uint32_t dst_x, uint32_t dst_y,
+		void *data) {
+	return readback->impl->finish(readback, flags, stride, dst_x, dst_y, data);
+}
+
+void wlr_renderer_readback_destroy(struct wlr_renderer_readback *readback) {
+	if (readback == NULL) {
+		return;
+	}
+	readback->impl->destroy(readback);
+}
+
 bool wlr_renderer_init_wl_display(struct wlr_renderer *r,
 		struct wl_display *wl_display) {
 	if (wl_display_init_shm(wl_display)) {
@@ -0,0 +1,1012 @@
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/backend.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_matrix.h>
+#include <wlr/types/wlr_output_damage.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/region.h>
+#include "render/wlr_texture.h"
+#include "util/signal.h"
+
+static struct wlr_scene *scene_root_from_node(struct wlr_scene_node *node) {
+	assert(node->type == WLR_SCENE_NODE_ROOT);
+	return (struct wlr_scene *)node;
+}
+
+struct wlr_scene_surface *wlr_scene_surface_from_node(
+		struct wlr_scene_node *node) {
+	assert(node->type == WLR_SCENE_NODE_SURFACE);
+	return (struct wlr_scene_surface *)node;
+}
+
+static struct wlr_scene_rect *scene_rect_from_node(
+		struct wlr_scene_node *node) {
+	assert(node->type == WLR_SCENE_NODE_RECT);
+	return (struct wlr_scene_rect *)node;
+}
+
+static struct wlr_scene_buffer *scene_buffer_from_node(
+		struct wlr_scene_node *node) {
+	assert(node->type == WLR_SCENE_NODE_BUFFER);
+	return (struct wlr_scene_buffer *)node;
+}
+
+static struct wlr_scene *scene_node_get_root(struct wlr_scene_node *node) {
+	while (node->parent != NULL) {
+		node = node->parent;
+	}
+	return scene_root_from_node(node);
+}
+
+static void scene_node_state_init(struct wlr_scene_node_state *state) {
+	wl_list_init(&state->children);
+	wl_list_init(&state->link);
+	state->enabled = true;
+}
+
+static void scene_node_state_finish(struct wlr_scene_node_state *state) {
+	wl_list_remove(&state->link);
+}
+
+static void scene_node_init(struct wlr_scene_node *node,
+		enum wlr_scene_node_type type, struct wlr_scene_node *parent) {
+	assert(type == WLR_SCENE_NODE_ROOT || parent != NULL);
+
+	node->type = type;
+	node->parent = parent;
+	scene_node_state_init(&node->state);
+	wl_signal_init(&node->events.destroy);
+
+	if (parent != NULL) {
+		wl_list_insert(parent->state.children.prev, &node->state.link);
+	}
+}
+
+static void scene_node_get_size(struct wlr_scene_node *node,
+		int *width, int *height) {
+	*width = 0;
+	*height = 0;
+
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:
+	case WLR_SCENE_NODE_TREE:
+		return;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		*width = scene_surface->surface->current.width;
+		*height = scene_surface->surface->current.height;
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *scene_rect = scene_rect_from_node(node);
+		*width = scene_rect->width;
+		*height = scene_rect->height;
+		break;
+	case WLR_SCENE_NODE_BUFFER:;
+		struct wlr_scene_buffer *scene_buffer = scene_buffer_from_node(node);
+		if (scene_buffer->dst_width > 0 && scene_buffer->dst_height > 0) {
+			*width = scene_buffer->dst_width;
+			*height = scene_buffer->dst_height;
+		} else if (scene_buffer->transform & WL_OUTPUT_TRANSFORM_90) {
+			*width = scene_buffer->buffer->height;
+			*height = scene_buffer->buffer->width;
+		} else {
+			*width = scene_buffer->buffer->width;
+			*height = scene_buffer->buffer->height;
+		}
+		break;
+	}
+}
+
+/**
+ * Converts a box in layout coordinates to output-buffer-local coordinates,
+ * rounding outwards.
+ */
+static void scene_output_get_box(struct wlr_scene_output *scene_output,
+		int lx, int ly, int width, int height, struct wlr_box *box) {
+	float scale = scene_output->output->scale;
+	int x1 = floor((lx - scene_output->x) * scale);
+	int y1 = floor((ly - scene_output->y) * scale);
+	int x2 = ceil((lx - scene_output->x + width) * scale);
+	int y2 = ceil((ly - scene_output->y + height) * scale);
+	box->x = x1;
+	box->y = y1;
+	box->width = x2 - x1;
+	box->height = y2 - y1;
+}
+
+static void scene_output_add_damage(struct wlr_scene_output *scene_output,
+		pixman_region32_t *damage) {
+	pixman_region32_t output_damage;
+	pixman_region32_init(&output_damage);
+	pixman_region32_copy(&output_damage, damage);
+	pixman_region32_translate(&output_damage,
+		-scene_output->x, -scene_output->y);
+	wlr_region_scale(&output_damage, &output_damage,
+		scene_output->output->scale);
+	wlr_output_damage_add(scene_output->damage, &output_damage);
+	pixman_region32_fini(&output_damage);
+}
+
+static void _scene_node_damage_whole(struct wlr_scene_node *node,
+		struct wlr_scene *scene, int lx, int ly) {
+	if (!node->state.enabled) {
+		return;
+	}
+
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &node->state.children, state.link) {
+		_scene_node_damage_whole(child, scene,
+			lx + child->state.x, ly + child->state.y);
+	}
+
+	int width, height;
+	scene_node_get_size(node, &width, &height);
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+
+	struct wlr_scene_output *scene_output;
+	wl_list_for_each(scene_output, &scene->outputs, link) {
+		struct wlr_box box;
+		scene_output_get_box(scene_output, lx, ly, width, height, &box);
+		wlr_output_damage_add_box(scene_output->damage, &box);
+	}
+}
+
+static void scene_node_damage_whole(struct wlr_scene_node *node) {
+	struct wlr_scene *scene = scene_node_get_root(node);
+	if (wl_list_empty(&scene->outputs)) {
+		return;
+	}
+
+	int lx, ly;
+	if (!wlr_scene_node_coords(node, &lx, &ly)) {
+		return;
+	}
+
+	_scene_node_damage_whole(node, scene, lx, ly);
+}
+
+static void scene_node_destroy(struct wlr_scene_node *node) {
+	wlr_signal_emit_safe(&node->events.destroy, NULL);
+
+	struct wlr_scene_node *child, *child_tmp;
+	wl_list_for_each_safe(child, child_tmp,
+			&node->state.children, state.link) {
+		scene_node_destroy(child);
+	}
+
+	scene_node_state_finish(&node->state);
+
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:;
+		struct wlr_scene *scene = scene_root_from_node(node);
+		struct wlr_scene_output *scene_output, *scene_output_tmp;
+		wl_list_for_each_safe(scene_output, scene_output_tmp,
+				&scene->outputs, link) {
+			wlr_scene_output_destroy(scene_output);
+		}
+		free(scene);
+		break;
+	case WLR_SCENE_NODE_TREE:;
+		struct wlr_scene_tree *tree = (struct wlr_scene_tree *)node;
+		free(tree);
+		break;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		wl_list_remove(&scene_surface->surface_commit.link);
+		wl_list_remove(&scene_surface->surface_destroy.link);
+		free(scene_surface);
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *scene_rect = scene_rect_from_node(node);
+		free(scene_rect);
+		break;
+	case WLR_SCENE_NODE_BUFFER:;
+		struct wlr_scene_buffer *scene_buffer = scene_buffer_from_node(node);
+		wlr_texture_destroy(scene_buffer->texture);
+		wlr_buffer_unlock(scene_buffer->buffer);
+		free(scene_buffer);
+		break;
+	}
+}
+
+void wlr_scene_node_destroy(struct wlr_scene_node *node) {
+	if (node == NULL) {
+		return;
+	}
+
+	// Damage the whole sub-tree once, children are destroyed silently
+	if (node->type != WLR_SCENE_NODE_ROOT) {
+		scene_node_damage_whole(node);
+	}
+	scene_node_destroy(node);
+}
+
+struct wlr_scene *wlr_scene_create(void) {
+	struct wlr_scene *scene = calloc(1, sizeof(struct wlr_scene));
+	if (scene == NULL) {
+		return NULL;
+	}
+	scene_node_init(&scene->node, WLR_SCENE_NODE_ROOT, NULL);
+	wl_list_init(&scene->outputs);
+	return scene;
+}
+
+struct wlr_scene_tree *wlr_scene_tree_create(struct wlr_scene_node *parent) {
+	struct wlr_scene_tree *tree = calloc(1, sizeof(struct wlr_scene_tree));
+	if (tree == NULL) {
+		return NULL;
+	}
+	scene_node_init(&tree->node, WLR_SCENE_NODE_TREE, parent);
+	return tree;
+}
+
+static void scene_surface_handle_surface_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_surface *scene_surface =
+		wl_container_of(listener, scene_surface, surface_destroy);
+	wlr_scene_node_destroy(&scene_surface->node);
+}
+
+static void scene_surface_handle_surface_commit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_surface *scene_surface =
+		wl_container_of(listener, scene_surface, surface_commit);
+	struct wlr_scene *scene = scene_node_get_root(&scene_surface->node);
+	if (wl_list_empty(&scene->outputs)) {
+		return;
+	}
+
+	int lx, ly;
+	if (!wlr_scene_node_coords(&scene_surface->node, &lx, &ly)) {
+		return;
+	}
+
+	// Only the parts of the surface the client has updated need a repaint.
+	// The effective damage also covers the previous bounds on resize.
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	wlr_surface_get_effective_damage(scene_surface->surface, &damage);
+	pixman_region32_translate(&damage, lx, ly);
+
+	struct wlr_scene_output *scene_output;
+	wl_list_for_each(scene_output, &scene->outputs, link) {
+		scene_output_add_damage(scene_output, &damage);
+	}
+
+	pixman_region32_fini(&damage);
+}
+
+struct wlr_scene_surface *wlr_scene_surface_create(struct wlr_scene_node *parent,
+		struct wlr_surface *surface) {
+	struct wlr_scene_surface *scene_surface =
+		calloc(1, sizeof(struct wlr_scene_surface));
+	if (scene_surface == NULL) {
+		return NULL;
+	}
+	scene_node_init(&scene_surface->node, WLR_SCENE_NODE_SURFACE, parent);
+
+	scene_surface->surface = surface;
+
+	scene_surface->surface_destroy.notify = scene_surface_handle_surface_destroy;
+	wl_signal_add(&surface->events.destroy, &scene_surface->surface_destroy);
+
+	scene_surface->surface_commit.notify = scene_surface_handle_surface_commit;
+	wl_signal_add(&surface->events.commit, &scene_surface->surface_commit);
+
+	scene_node_damage_whole(&scene_surface->node);
+
+	return scene_surface;
+}
+
+struct wlr_scene_rect *wlr_scene_rect_create(struct wlr_scene_node *parent,
+		int width, int height, const float color[static 4]) {
+	struct wlr_scene_rect *scene_rect =
+		calloc(1, sizeof(struct wlr_scene_rect));
+	if (scene_rect == NULL) {
+		return NULL;
+	}
+	scene_node_init(&scene_rect->node, WLR_SCENE_NODE_RECT, parent);
+
+	scene_rect->width = width;
+	scene_rect->height = height;
+	memcpy(scene_rect->color, color, sizeof(scene_rect->color));
+
+	scene_node_damage_whole(&scene_rect->node);
+
+	return scene_rect;
+}
+
+void wlr_scene_rect_set_size(struct wlr_scene_rect *rect, int width, int height) {
+	if (rect->width == width && rect->height == height) {
+		return;
+	}
+
+	scene_node_damage_whole(&rect->node);
+	rect->width = width;
+	rect->height = height;
+	scene_node_damage_whole(&rect->node);
+}
+
+void wlr_scene_rect_set_color(struct wlr_scene_rect *rect,
+		const float color[static 4]) {
+	if (memcmp(rect->color, color, sizeof(rect->color)) == 0) {
+		return;
+	}
+
+	memcpy(rect->color, color, sizeof(rect->color));
+	scene_node_damage_whole(&rect->node);
+}
+
+struct wlr_scene_buffer *wlr_scene_buffer_create(struct wlr_scene_node *parent,
+		struct wlr_buffer *buffer) {
+	struct wlr_scene_buffer *scene_buffer = calloc(1, sizeof(*scene_buffer));
+	if (scene_buffer == NULL) {
+		return NULL;
+	}
+	scene_node_init(&scene_buffer->node, WLR_SCENE_NODE_BUFFER, parent);
+
+	scene_buffer->buffer = wlr_buffer_lock(buffer);
+
+	scene_node_damage_whole(&scene_buffer->node);
+
+	return scene_buffer;
+}
+
+void wlr_scene_buffer_set_dest_size(struct wlr_scene_buffer *scene_buffer,
+		int width, int height) {
+	if (scene_buffer->dst_width == width && scene_buffer->dst_height == height) {
+		return;
+	}
+
+	scene_node_damage_whole(&scene_buffer->node);
+	scene_buffer->dst_width = width;
+	scene_buffer->dst_height = height;
+	scene_node_damage_whole(&scene_buffer->node);
+}
+
+void wlr_scene_buffer_set_transform(struct wlr_scene_buffer *scene_buffer,
+		enum wl_output_transform transform) {
+	if (scene_buffer->transform == transform) {
+		return;
+	}
+
+	scene_node_damage_whole(&scene_buffer->node);
+	scene_buffer->transform = transform;
+	scene_node_damage_whole(&scene_buffer->node);
+}
+
+void wlr_scene_node_set_enabled(struct wlr_scene_node *node, bool enabled) {
+	if (node->state.enabled == enabled) {
+		return;
+	}
+
+	// One of these damage_whole() calls will short-circuit and be a no-op
+	scene_node_damage_whole(node);
+	node->state.enabled = enabled;
+	scene_node_damage_whole(node);
+}
+
+void wlr_scene_node_set_position(struct wlr_scene_node *node, int x, int y) {
+	if (node->state.x == x && node->state.y == y) {
+		return;
+	}
+
+	scene_node_damage_whole(node);
+	node->state.x = x;
+	node->state.y = y;
+	scene_node_damage_whole(node);
+}
+
+void wlr_scene_node_place_above(struct wlr_scene_node *node,
+		struct wlr_scene_node *sibling) {
+	assert(node != sibling);
+	assert(node->parent == sibling->parent);
+
+	if (node->state.link.prev == &sibling->state.link) {
+		return;
+	}
+
+	wl_list_remove(&node->state.link);
+	wl_list_insert(&sibling->state.link, &node->state.link);
+
+	scene_node_damage_whole(node);
+	scene_node_damage_whole(sibling);
+}
+
+void wlr_scene_node_place_below(struct wlr_scene_node *node,
+		struct wlr_scene_node *sibling) {
+	assert(node != sibling);
+	assert(node->parent == sibling->parent);
+
+	if (node->state.link.next == &sibling->state.link) {
+		return;
+	}
+
+	wl_list_remove(&node->state.link);
+	wl_list_insert(sibling->state.link.prev, &node->state.link);
+
+	scene_node_damage_whole(node);
+	scene_node_damage_whole(sibling);
+}
+
+void wlr_scene_node_raise_to_top(struct wlr_scene_node *node) {
+	struct wlr_scene_node *current_top = wl_container_of(
+		node->parent->state.children.prev, current_top, state.link);
+	if (node == current_top) {
+		return;
+	}
+	wlr_scene_node_place_above(node, current_top);
+}
+
+void wlr_scene_node_lower_to_bottom(struct wlr_scene_node *node) {
+	struct wlr_scene_node *current_bottom = wl_container_of(
+		node->parent->state.children.next, current_bottom, state.link);
+	if (node == current_bottom) {
+		return;
+	}
+	wlr_scene_node_place_below(node, current_bottom);
+}
+
+void wlr_scene_node_reparent(struct wlr_scene_node *node,
+		struct wlr_scene_node *new_parent) {
+	assert(node->type != WLR_SCENE_NODE_ROOT && new_parent != NULL);
+
+	if (node->parent == new_parent) {
+		return;
+	}
+
+	// Ensure that a node cannot become its own ancestor
+	for (struct wlr_scene_node *ancestor = new_parent; ancestor != NULL;
+			ancestor = ancestor->parent) {
+		assert(ancestor != node);
+	}
+
+	scene_node_damage_whole(node);
+
+	wl_list_remove(&node->state.link);
+	node->parent = new_parent;
+	wl_list_insert(new_parent->state.children.prev, &node->state.link);
+
+	scene_node_damage_whole(node);
+}
+
+bool wlr_scene_node_coords(struct wlr_scene_node *node,
+		int *lx_ptr, int *ly_ptr) {
+	int lx = 0, ly = 0;
+	bool enabled = true;
+	while (node != NULL) {
+		lx += node->state.x;
+		ly += node->state.y;
+		enabled = enabled && node->state.enabled;
+		node = node->parent;
+	}
+
+	*lx_ptr = lx;
+	*ly_ptr = ly;
+	return enabled;
+}
+
+static void scene_node_for_each_surface(struct wlr_scene_node *node,
+		int lx, int ly, wlr_surface_iterator_func_t user_iterator,
+		void *user_data) {
+	if (!node->state.enabled) {
+		return;
+	}
+
+	lx += node->state.x;
+	ly += node->state.y;
+
+	if (node->type == WLR_SCENE_NODE_SURFACE) {
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		user_iterator(scene_surface->surface, lx, ly, user_data);
+	}
+
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &node->state.children, state.link) {
+		scene_node_for_each_surface(child, lx, ly, user_iterator, user_data);
+	}
+}
+
+void wlr_scene_node_for_each_surface(struct wlr_scene_node *node,
+		wlr_surface_iterator_func_t user_iterator, void *user_data) {
+	scene_node_for_each_surface(node, 0, 0, user_iterator, user_data);
+}
+
+struct wlr_scene_node *wlr_scene_node_at(struct wlr_scene_node *node,
+		double lx, double ly, double *nx, double *ny) {
+	if (!node->state.enabled) {
+		return NULL;
+	}
+
+	// TODO: optimize by storing a bounding box in each node?
+	lx -= node->state.x;
+	ly -= node->state.y;
+
+	struct wlr_scene_node *child;
+	wl_list_for_each_reverse(child, &node->state.children, state.link) {
+		struct wlr_scene_node *found =
+			wlr_scene_node_at(child, lx, ly, nx, ny);
+		if (found != NULL) {
+			return found;
+		}
+	}
+
+	bool hit = false;
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:
+	case WLR_SCENE_NODE_TREE:
+		break;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		hit = wlr_surface_point_accepts_input(scene_surface->surface, lx, ly);
+		break;
+	case WLR_SCENE_NODE_RECT:
+	case WLR_SCENE_NODE_BUFFER:;
+		int width, height;
+		scene_node_get_size(node, &width, &height);
+		hit = lx >= 0 && lx < width && ly >= 0 && ly < height;
+		break;
+	}
+
+	if (!hit) {
+		return NULL;
+	}
+
+	if (nx != NULL) {
+		*nx = lx;
+	}
+	if (ny != NULL) {
+		*ny = ly;
+	}
+	return node;
+}
+
+static void scene_output_handle_damage_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_output *scene_output =
+		wl_container_of(listener, scene_output, damage_destroy);
+	// The output damage is being destroyed along with the output
+	scene_output->damage = NULL;
+	wlr_scene_output_destroy(scene_output);
+}
+
+struct wlr_scene_output *wlr_scene_output_create(struct wlr_scene *scene,
+		struct wlr_output *output) {
+	assert(wlr_scene_get_scene_output(scene, output) == NULL);
+
+	struct wlr_scene_output *scene_output = calloc(1, sizeof(*scene_output));
+	if (scene_output == NULL) {
+		return NULL;
+	}
+
+	scene_output->damage = wlr_output_damage_create(output);
+	if (scene_output->damage == NULL) {
+		free(scene_output);
+		return NULL;
+	}
+
+	scene_output->output = output;
+	scene_output->scene = scene;
+	wl_list_insert(scene->outputs.prev, &scene_output->link);
+
+	scene_output->damage_destroy.notify = scene_output_handle_damage_destroy;
+	wl_signal_add(&scene_output->damage->events.destroy,
+		&scene_output->damage_destroy);
+
+	wlr_output_damage_add_whole(scene_output->damage);
+
+	return scene_output;
+}
+
+void wlr_scene_output_destroy(struct wlr_scene_output *scene_output) {
+	if (scene_output == NULL) {
+		return;
+	}
+
+	wl_list_remove(&scene_output->link);
+	wl_list_remove(&scene_output->damage_destroy.link);
+	wlr_output_damage_destroy(scene_output->damage);
+	free(scene_output);
+}
+
+struct wlr_scene_output *wlr_scene_get_scene_output(struct wlr_scene *scene,
+		struct wlr_output *output) {
+	struct wlr_scene_output *scene_output;
+	wl_list_for_each(scene_output, &scene->outputs, link) {
+		if (scene_output->output == output) {
+			return scene_output;
+		}
+	}
+	return NULL;
+}
+
+void wlr_scene_output_set_position(struct wlr_scene_output *scene_output,
+		int lx, int ly) {
+	if (scene_output->x == lx && scene_output->y == ly) {
+		return;
+	}
+
+	scene_output->x = lx;
+	scene_output->y = ly;
+	wlr_output_damage_add_whole(scene_output->damage);
+}
+
+struct render_entry {
+	struct wlr_scene_node *node;
+	int lx, ly; // layout coordinates
+	struct wlr_box box; // output-buffer-local coordinates
+	pixman_region32_t visible; // parts of the damage to repaint
+};
+
+static struct wlr_texture *scene_node_get_texture(struct wlr_scene_node *node,
+		struct wlr_renderer *renderer) {
+	switch (node->type) {
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		return wlr_surface_get_texture(scene_surface->surface);
+	case WLR_SCENE_NODE_BUFFER:;
+		struct wlr_scene_buffer *scene_buffer = scene_buffer_from_node(node);
+		if (scene_buffer->texture == NULL) {
+			// Textures can't be created while rendering, so this must
+			// happen before wlr_renderer_begin
+			scene_buffer->texture =
+				wlr_texture_from_buffer(renderer, scene_buffer->buffer);
+		}
+		return scene_buffer->texture;
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * Collects the nodes intersecting the output, bottom-most first.
+ */
+static void scene_output_collect_nodes(struct wlr_scene_output *scene_output,
+		struct wlr_scene_node *node, int lx, int ly,
+		struct wlr_renderer *renderer, struct wl_array *entries) {
+	if (!node->state.enabled) {
+		return;
+	}
+
+	lx += node->state.x;
+	ly += node->state.y;
+
+	int width, height;
+	scene_node_get_size(node, &width, &height);
+
+	bool drawable = width > 0 && height > 0;
+	if (drawable && node->type != WLR_SCENE_NODE_RECT) {
+		drawable = scene_node_get_texture(node, renderer) != NULL;
+	}
+
+	struct wlr_box box;
+	scene_output_get_box(scene_output, lx, ly, width, height, &box);
+
+	int output_width, output_height;
+	wlr_output_transformed_resolution(scene_output->output,
+		&output_width, &output_height);
+	struct wlr_box output_box = {
+		.width = output_width,
+		.height = output_height,
+	};
+	struct wlr_box intersection;
+	if (drawable && wlr_box_intersection(&intersection, &box, &output_box)) {
+		struct render_entry *entry = wl_array_add(entries, sizeof(*entry));
+		if (entry != NULL) {
+			entry->node = node;
+			entry->lx = lx;
+			entry->ly = ly;
+			entry->box = box;
+		}
+	}
+
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &node->state.children, state.link) {
+		scene_output_collect_nodes(scene_output, child, lx, ly,
+			renderer, entries);
+	}
+}
+
+/**
+ * Adds the region fully covered by the node to `opaque`, in
+ * output-buffer-local coordinates. Coordinates are rounded inwards so that
+ * partially covered pixels are never considered opaque.
+ */
+static void scene_output_add_opaque_region(
+		struct wlr_scene_output *scene_output, struct render_entry *entry,
+		pixman_region32_t *opaque) {
+	struct wlr_scene_node *node = entry->node;
+
+	pixman_region32_t node_opaque;
+	pixman_region32_init(&node_opaque);
+
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:
+	case WLR_SCENE_NODE_TREE:
+		break;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		pixman_region32_copy(&node_opaque,
+			&scene_surface->surface->opaque_region);
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *scene_rect = scene_rect_from_node(node);
+		if (scene_rect->color[3] >= 1.0) {
+			pixman_region32_union_rect(&node_opaque, &node_opaque, 0, 0,
+				scene_rect->width, scene_rect->height);
+		}
+		break;
+	case WLR_SCENE_NODE_BUFFER:;
+		struct wlr_scene_buffer *scene_buffer = scene_buffer_from_node(node);
+		if (wlr_texture_is_opaque(scene_buffer->texture)) {
+			int width, height;
+			scene_node_get_size(node, &width, &height);
+			pixman_region32_union_rect(&node_opaque, &node_opaque,
+				0, 0, width, height);
+		}
+		break;
+	}
+
+	float scale = scene_output->output->scale;
+	int dx = entry->lx - scene_output->x;
+	int dy = entry->ly - scene_output->y;
+
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&node_opaque, &nrects);
+	for (int i = 0; i < nrects; i++) {
+		int x1 = ceil((dx + rects[i].x1) * scale);
+		int y1 = ceil((dy + rects[i].y1) * scale);
+		int x2 = floor((dx + rects[i].x2) * scale);
+		int y2 = floor((dy + rects[i].y2) * scale);
+		if (x1 < x2 && y1 < y2) {
+			pixman_region32_union_rect(opaque, opaque,
+				x1, y1, x2 - x1, y2 - y1);
+		}
+	}
+
+	pixman_region32_fini(&node_opaque);
+}
+
+static void scissor_output(struct wlr_output *output, pixman_box32_t *rect) {
+	struct wlr_renderer *renderer = wlr_backend_get_renderer(output->backend);
+	assert(renderer);
+
+	struct wlr_box box = {
+		.x = rect->x1,
+		.y = rect->y1,
+		.width = rect->x2 - rect->x1,
+		.height = rect->y2 - rect->y1,
+	};
+
+	int ow, oh;
+	wlr_output_transformed_resolution(output, &ow, &oh);
+
+	enum wl_output_transform transform =
+		wlr_output_transform_invert(output->transform);
+	wlr_box_transform(&box, &box, transform, ow, oh);
+
+	wlr_renderer_scissor(renderer, &box);
+}
+
+static void render_entry(struct wlr_output *output,
+		struct wlr_renderer *renderer, struct render_entry *entry) {
+	struct wlr_scene_node *node = entry->node;
+
+	float matrix[9];
+	enum wl_output_transform transform;
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:
+	case WLR_SCENE_NODE_TREE:
+		break;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		struct wlr_surface *surface = scene_surface->surface;
+
+		struct wlr_fbox src_box;
+		wlr_surface_get_buffer_source_box(surface, &src_box);
+
+		transform = wlr_output_transform_invert(surface->current.transform);
+		wlr_matrix_project_box(matrix, &entry->box, transform, 0.0,
+			output->transform_matrix);
+		wlr_render_subtexture_with_matrix(renderer,
+			wlr_surface_get_texture(surface), &src_box, matrix, 1.0);
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *scene_rect = scene_rect_from_node(node);
+		wlr_render_rect(renderer, &entry->box, scene_rect->color,
+			output->transform_matrix);
+		break;
+	case WLR_SCENE_NODE_BUFFER:;
+		struct wlr_scene_buffer *scene_buffer = scene_buffer_from_node(node);
+		transform = wlr_output_transform_invert(scene_buffer->transform);
+		wlr_matrix_project_box(matrix, &entry->box, transform, 0.0,
+			output->transform_matrix);
+		wlr_render_texture_with_matrix(renderer, scene_buffer->texture,
+			matrix, 1.0);
+		break;
+	}
+}
+
+/**
+ * Tries to display the top-most node directly, if it's a surface covering the
+ * whole output and hiding everything below.
+ */
+static bool scene_output_scanout(struct wlr_scene_output *scene_output,
+		struct render_entry *list, size_t len) {
+	if (len == 0) {
+		return false;
+	}
+
+	struct render_entry *top = &list[len - 1];
+	if (top->node->type != WLR_SCENE_NODE_SURFACE ||
+			top->box.x != 0 || top->box.y != 0) {
+		return false;
+	}
+
+	struct wlr_scene_surface *scene_surface =
+		wlr_scene_surface_from_node(top->node);
+	return wlr_output_attach_surface_scanout(scene_output->output,
+		scene_surface->surface);
+}
+
+bool wlr_scene_output_commit(struct wlr_scene_output *scene_output) {
+	struct wlr_output *output = scene_output->output;
+
+	struct wlr_renderer *renderer = wlr_backend_get_renderer(output->backend);
+	assert(renderer != NULL);
+
+	struct wl_array entries;
+	wl_array_init(&entries);
+	scene_output_collect_nodes(scene_output, &scene_output->scene->node,
+		0, 0, renderer, &entries);
+
+	if ((output->needs_frame ||
+			pixman_region32_not_empty(&scene_output->damage->current)) &&
+			scene_output_scanout(scene_output, entries.data,
+			entries.size / sizeof(struct render_entry))) {
+		wl_array_release(&entries);
+		return wlr_output_commit(output);
+	}
+
+	bool needs_frame;
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	if (!wlr_output_damage_attach_render(scene_output->damage,
+			&needs_frame, &damage)) {
+		pixman_region32_fini(&damage);
+		wl_array_release(&entries);
+		return false;
+	}
+
+	if (!needs_frame) {
+		pixman_region32_fini(&damage);
+		wl_array_release(&entries);
+		wlr_output_rollback(output);
+		return true;
+	}
+
+	// Walk the nodes top-most first to find out which parts of each node are
+	// not hidden behind opaque nodes. Fully occluded nodes are skipped.
+	struct render_entry *list = entries.data;
+	size_t len = entries.size / sizeof(*list);
+	pixman_region32_t opaque;
+	pixman_region32_init(&opaque);
+	for (size_t i = len; i-- > 0;) {
+		struct render_entry *entry = &list[i];
+		pixman_region32_init_rect(&entry->visible, entry->box.x, entry->box.y,
+			entry->box.width, entry->box.height);
+		pixman_region32_intersect(&entry->visible, &entry->visible, &damage);
+		pixman_region32_subtract(&entry->visible, &entry->visible, &opaque);
+		scene_output_add_opaque_region(scene_output, entry, &opaque);
+	}
+
+	pixman_region32_t background;
+	pixman_region32_init(&background);
+	pixman_region32_subtract(&background, &damage, &opaque);
+	pixman_region32_fini(&opaque);
+
+	wlr_renderer_begin(renderer, output->width, output->height);
+
+	float clear_color[4] = { 0.0, 0.0, 0.0, 1.0 };
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&background, &nrects);
+	for (int i = 0; i < nrects; i++) {
+		scissor_output(output, &rects[i]);
+		wlr_renderer_clear(renderer, clear_color);
+	}
+	pixman_region32_fini(&background);
+
+	for (size_t i = 0; i < len; i++) {
+		struct render_entry *entry = &list[i];
+		rects = pixman_region32_rectangles(&entry->visible, &nrects);
+		for (int j = 0; j < nrects; j++) {
+			scissor_output(output, &rects[j]);
+			render_entry(output, renderer, entry);
+		}
+		pixman_region32_fini(&entry->visible);
+	}
+	wl_array_release(&entries);
+
+	wlr_renderer_scissor(renderer, NULL);
+	wlr_output_render_software_cursors(output, &damage);
+
+	wlr_renderer_end(renderer);
+	pixman_region32_fini(&damage);
+
+	int tr_width, tr_height;
+	wlr_output_transformed_resolution(output, &tr_width, &tr_height);
+
+	enum wl_output_transform transform =
+		wlr_output_transform_invert(output->transform);
+
+	pixman_region32_t frame_damage;
+	pixman_region32_init(&frame_damage);
+	wlr_region_transform(&frame_damage, &scene_output->damage->current,
+		transform, tr_width, tr_height);
+	wlr_output_set_damage(output, &frame_damage);
+	pixman_region32_fini(&frame_damage);
+
+	return wlr_output_commit(output);
+}
+
+static void scene_output_send_frame_done_iterator(struct wlr_scene_node *node,
+		struct wlr_scene_output *scene_output, struct timespec *now,
+		int lx, int ly) {
+	if (!node->state.enabled) {
+		return;
+	}
+
+	lx += node->state.x;
+	ly += node->state.y;
+
+	if (node->type == WLR_SCENE_NODE_SURFACE) {
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		int width, height;
+		scene_node_get_size(node, &width, &height);
+
+		struct wlr_box box = {
+			.x = lx,
+			.y = ly,
+			.width = width,
+			.height = height,
+		};
+		struct wlr_box output_box = {
+			.x = scene_output->x,
+			.y = scene_output->y,
+		};
+		wlr_output_effective_resolution(scene_output->output,
+			&output_box.width, &output_box.height);
+
+		struct wlr_box intersection;
+		if (wlr_box_intersection(&intersection, &box, &output_box)) {
+			wlr_surface_send_frame_done(scene_surface->surface, now);
+		}
+	}
+
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &node->state.children, state.link) {
+		scene_output_send_frame_done_iterator(child, scene_output, now,
+			lx, ly);
+	}
+}
+
+void wlr_scene_output_send_frame_done(struct wlr_scene_output *scene_output,
+		struct timespec *now) {
+	scene_output_send_frame_done_iterator(&scene_output->scene->node,
+		scene_output, now, 0, 0);
+}
@@ -1,9 +1,11 @@
 #include <assert.h>
 #include <stdlib.h>
+#include <wlr/render/interface.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_buffer.h>
 #include <wlr/types/wlr_linux_dmabuf_v1.h>
 #include <wlr/util/log.h>
+#include <wlr/util/region.h>
 #include "render/pixel_format.h"
 #include "render/wlr_texture.h"
 #include "types/wlr_buffer.h"
@@ -148,6 +150,113 @@ static struct wlr_client_buffer *client_buffer_from_buffer(
 	return client_buffer;
 }
 
+#define CLIENT_TEXTURE_POOL_CAP 3
+// Beyond this number of damage rectangles, uploads are merged
+#define CLIENT_BUFFER_MAX_UPLOAD_RECTS 8
+
+struct wlr_client_texture {
+	struct wlr_texture *texture; // NULL if the slot is unused
+	struct wlr_client_buffer *owner; // NULL if the texture is free
+	bool writable; // the texture supports partial uploads
+	// Damage accumulated since the texture was last up-to-date
+	pixman_region32_t damage;
+};
+
+/**
+ * Textures of successive wl_shm buffers attached to a surface. A free texture
+ * can be recycled when the current one is still referenced elsewhere, in which
+ * case only the damage accumulated since its last use needs to be uploaded.
+ */
+struct wlr_client_texture_pool {
+	struct wlr_renderer *renderer;
+	size_t n_refs;
+
+	enum wl_shm_format format;
+	int width, height;
+
+	struct wlr_client_texture textures[CLIENT_TEXTURE_POOL_CAP];
+};
+
+static struct wlr_client_texture_pool *texture_pool_create(
+		struct wlr_renderer *renderer, enum wl_shm_format format,
+		int width, int height) {
+	struct wlr_client_texture_pool *pool = calloc(1, sizeof(*pool));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->renderer = renderer;
+	pool->format = format;
+	pool->width = width;
+	pool->height = height;
+	for (size_t i = 0; i < CLIENT_TEXTURE_POOL_CAP; i++) {
+		pixman_region32_init(&pool->textures[i].damage);
+	}
+	return pool;
+}
+
+static void texture_pool_unref(struct wlr_client_texture_pool *pool) {
+	assert(pool->n_refs > 0);
+	pool->n_refs--;
+	if (pool->n_refs > 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < CLIENT_TEXTURE_POOL_CAP; i++) {
+		struct wlr_client_texture *tex = &pool->textures[i];
+		assert(tex->owner == NULL);
+		wlr_texture_destroy(tex->texture);
+		pixman_region32_fini(&tex->damage);
+	}
+	free(pool);
+}
+
+static struct wlr_client_texture *texture_pool_find(
+		struct wlr_client_texture_pool *pool,
+		struct wlr_client_buffer *owner) {
+	for (size_t i = 0; i < CLIENT_TEXTURE_POOL_CAP; i++) {
+		struct wlr_client_texture *tex = &pool->textures[i];
+		if (tex->texture != NULL && tex->owner == owner) {
+			return tex;
+		}
+	}
+	return NULL;
+}
+
+static struct wlr_client_texture *texture_pool_find_unused(
+		struct wlr_client_texture_pool *pool) {
+	for (size_t i = 0; i < CLIENT_TEXTURE_POOL_CAP; i++) {
+		struct wlr_client_texture *tex = &pool->textures[i];
+		if (tex->texture == NULL) {
+			return tex;
+		}
+	}
+	return NULL;
+}
+
+static struct wlr_client_texture *texture_pool_add(
+		struct wlr_client_texture_pool *pool, struct wlr_texture *texture) {
+	struct wlr_client_texture *tex = texture_pool_find_unused(pool);
+	assert(tex != NULL);
+	tex->texture = texture;
+	tex->writable = texture->impl->write_pixels != NULL;
+	pixman_region32_fini(&tex->damage);
+	pixman_region32_init(&tex->damage);
+	return tex;
+}
+
+static void texture_pool_release(struct wlr_client_texture_pool *pool,
+		struct wlr_client_buffer *owner) {
+	struct wlr_client_texture *tex = texture_pool_find(pool, owner);
+	assert(tex != NULL);
+	tex->owner = NULL;
+	if (!tex->writable) {
+		// Not worth keeping around: we can't upload damage to it
+		wlr_texture_destroy(tex->texture);
+		tex->texture = NULL;
+	}
+	texture_pool_unref(pool);
+}
+
 static void client_buffer_destroy(struct wlr_buffer *_buffer) {
 	struct wlr_client_buffer *buffer = client_buffer_from_buffer(_buffer);
 
@@ -156,7 +265,11 @@ static void client_buffer_destroy(struct wlr_buffer *_buffer) {
 	}
 
 	wl_list_remove(&buffer->resource_destroy.link);
-	wlr_texture_destroy(buffer->texture);
+	if (buffer->texture_pool != NULL) {
+		texture_pool_release(buffer->texture_pool, buffer);
+	} else {
+		wlr_texture_destroy(buffer->texture);
+	}
 	free(buffer);
 }
 
@@ -211,6 +324,33 @@ static void client_buffer_handle_release(struct wl_listener *listener,
 	}
 }
 
+static struct wlr_client_buffer *client_buffer_create(
+		struct wlr_texture *texture, struct wl_resource *resource,
+		bool resource_released) {
+	struct wlr_client_buffer *buffer =
+		calloc(1, sizeof(struct wlr_client_buffer));
+	if (buffer == NULL) {
+		return NULL;
+	}
+	wlr_buffer_init(&buffer->base, &client_buffer_impl,
+		texture->width, texture->height);
+	buffer->resource = resource;
+	buffer->texture = texture;
+	buffer->resource_released = resource_released;
+
+	wl_resource_add_destroy_listener(resource, &buffer->resource_destroy);
+	buffer->resource_destroy.notify = client_buffer_resource_handle_destroy;
+
+	buffer->release.notify = client_buffer_handle_release;
+	wl_signal_add(&buffer->base.events.release, &buffer->release);
+
+	// Ensure the buffer will be released before being destroyed
+	wlr_buffer_lock(&buffer->base);
+	wlr_buffer_drop(&buffer->base);
+
+	return buffer;
+}
+
 struct wlr_client_buffer *wlr_client_buffer_import(
 		struct wlr_renderer *renderer, struct wl_resource *resource) {
 	assert(wlr_resource_is_buffer(resource));
@@ -266,29 +406,79 @@ struct wlr_client_buffer *wlr_client_buffer_import(
 	}
 
 	struct wlr_client_buffer *buffer =
-		calloc(1, sizeof(struct wlr_client_buffer));
+		client_buffer_create(texture, resource, resource_released);
 	if (buffer == NULL) {
 		wlr_texture_destroy(texture);
 		wl_resource_post_no_memory(resource);
 		return NULL;
 	}
-	wlr_buffer_init(&buffer->base, &client_buffer_impl,
-		texture->width, texture->height);
-	buffer->resource = resource;
-	buffer->texture = texture;
-	buffer->resource_released = resource_released;
 
-	wl_resource_add_destroy_listener(resource, &buffer->resource_destroy);
-	buffer->resource_destroy.notify = client_buffer_resource_handle_destroy;
+	struct wl_shm_buffer *shm_buf = wl_shm_buffer_get(resource);
+	if (shm_buf != NULL) {
+		// Not fatal: without a pool, damage is only applied in-place
+		buffer->texture_pool = texture_pool_create(renderer,
+			wl_shm_buffer_get_format(shm_buf), texture->width,
+			texture->height);
+		if (buffer->texture_pool != NULL) {
+			struct wlr_client_texture *tex =
+				texture_pool_add(buffer->texture_pool, texture);
+			tex->owner = buffer;
+			buffer->texture_pool->n_refs++;
+		}
+	}
 
-	buffer->release.notify = client_buffer_handle_release;
-	wl_signal_add(&buffer->base.events.release, &buffer->release);
+	return buffer;
+}
 
-	// Ensure the buffer will be released before being destroyed
-	wlr_buffer_lock(&buffer->base);
-	wlr_buffer_drop(&buffer->base);
+static bool texture_upload_damage(struct wlr_texture *texture,
+		struct wl_shm_buffer *shm_buf, pixman_region32_t *damage) {
+	int32_t stride = wl_shm_buffer_get_stride(shm_buf);
 
-	return buffer;
+	// Many small uploads are slower than a few larger ones
+	pixman_region32_t upload;
+	pixman_region32_init(&upload);
+	wlr_region_simplify(&upload, damage, CLIENT_BUFFER_MAX_UPLOAD_RECTS);
+
+	wl_shm_buffer_begin_access(shm_buf);
+	void *data = wl_shm_buffer_get_data(shm_buf);
+
+	bool ok = true;
+	int n;
+	pixman_box32_t *rects = pixman_region32_rectangles(&upload, &n);
+	for (int i = 0; i < n; ++i) {
+		pixman_box32_t *r = &rects[i];
+		if (!wlr_texture_write_pixels(texture, stride,
+				r->x2 - r->x1, r->y2 - r->y1, r->x1, r->y1,
+				r->x1, r->y1, data)) {
+			ok = false;
+			break;
+		}
+	}
+
+	wl_shm_buffer_end_access(shm_buf);
+	pixman_region32_fini(&upload);
+	return ok;
+}
+
+static struct wlr_client_texture *texture_pool_create_texture(
+		struct wlr_client_texture_pool *pool, struct wl_shm_buffer *shm_buf) {
+	if (texture_pool_find_unused(pool) == NULL) {
+		return NULL;
+	}
+
+	uint32_t drm_format = convert_wl_shm_format_to_drm(pool->format);
+	int32_t stride = wl_shm_buffer_get_stride(shm_buf);
+
+	wl_shm_buffer_begin_access(shm_buf);
+	void *data = wl_shm_buffer_get_data(shm_buf);
+	struct wlr_texture *texture = wlr_texture_from_pixels(pool->renderer,
+		drm_format, stride, pool->width, pool->height, data);
+	wl_shm_buffer_end_access(shm_buf);
+	if (texture == NULL) {
+		return NULL;
+	}
+
+	return texture_pool_add(pool, texture);
 }
 
 struct wlr_client_buffer *wlr_client_buffer_apply_damage(
@@ -296,51 +486,98 @@ struct wlr_client_buffer *wlr_client_buffer_apply_damage(
 		pixman_region32_t *damage) {
 	assert(wlr_resource_is_buffer(resource));
 
-	if (buffer->base.n_locks > 1) {
-		// Someone else still has a reference to the buffer
+	struct wlr_client_texture_pool *pool = buffer->texture_pool;
+	if (pool == NULL) {
+		// Uploading only damaged regions only works for wl_shm buffers and
+		// mutable textures (created from wl_shm buffer)
 		return NULL;
 	}
 
 	struct wl_shm_buffer *shm_buf = wl_shm_buffer_get(resource);
-	struct wl_shm_buffer *old_shm_buf = wl_shm_buffer_get(buffer->resource);
-	if (shm_buf == NULL || old_shm_buf == NULL) {
-		// Uploading only damaged regions only works for wl_shm buffers and
-		// mutable textures (created from wl_shm buffer)
+	if (shm_buf == NULL) {
 		return NULL;
 	}
 
-	enum wl_shm_format new_fmt = wl_shm_buffer_get_format(shm_buf);
-	enum wl_shm_format old_fmt = wl_shm_buffer_get_format(old_shm_buf);
-	if (new_fmt != old_fmt) {
+	if (wl_shm_buffer_get_format(shm_buf) != pool->format) {
 		// Uploading to textures can't change the format
 		return NULL;
 	}
 
-	int32_t stride = wl_shm_buffer_get_stride(shm_buf);
-	int32_t width = wl_shm_buffer_get_width(shm_buf);
-	int32_t height = wl_shm_buffer_get_height(shm_buf);
+	if (wl_shm_buffer_get_width(shm_buf) != pool->width ||
+			wl_shm_buffer_get_height(shm_buf) != pool->height) {
+		return NULL;
+	}
 
-	if ((uint32_t)width != buffer->texture->width ||
-			(uint32_t)height != buffer->texture->height) {
+	struct wlr_client_texture *tex = texture_pool_find(pool, buffer);
+	assert(tex != NULL);
+	if (!tex->writable) {
+		// Other textures of the pool come from the same renderer, so they
+		// can't be updated either
 		return NULL;
 	}
 
-	wl_shm_buffer_begin_access(shm_buf);
-	void *data = wl_shm_buffer_get_data(shm_buf);
+	pixman_region32_t buffer_damage;
+	pixman_region32_init(&buffer_damage);
+	pixman_region32_intersect_rect(&buffer_damage, damage,
+		0, 0, pool->width, pool->height);
 
-	int n;
-	pixman_box32_t *rects = pixman_region32_rectangles(damage, &n);
-	for (int i = 0; i < n; ++i) {
-		pixman_box32_t *r = &rects[i];
-		if (!wlr_texture_write_pixels(buffer->texture, stride,
-				r->x2 - r->x1, r->y2 - r->y1, r->x1, r->y1,
-				r->x1, r->y1, data)) {
-			wl_shm_buffer_end_access(shm_buf);
+	if (buffer->base.n_locks > 1) {
+		// Someone else still has a reference to the buffer, so its texture
+		// can't be modified. Recycle a free texture instead, or grow the pool.
+		tex = texture_pool_find(pool, NULL);
+		if (tex == NULL) {
+			// The new texture already contains the whole buffer
+			tex = texture_pool_create_texture(pool, shm_buf);
+			if (tex == NULL) {
+				pixman_region32_fini(&buffer_damage);
+				return NULL;
+			}
+		} else {
+			// A recycled texture also needs the damage it missed while it
+			// was free
+			pixman_region32_union(&tex->damage, &tex->damage,
+				&buffer_damage);
+		}
+	} else {
+		pixman_region32_union(&tex->damage, &tex->damage, &buffer_damage);
+	}
+
+	if (pixman_region32_not_empty(&tex->damage)) {
+		if (!texture_upload_damage(tex->texture, shm_buf, &tex->damage)) {
+			pixman_region32_fini(&buffer_damage);
 			return NULL;
 		}
+		pixman_region32_fini(&tex->damage);
+		pixman_region32_init(&tex->damage);
 	}
 
-	wl_shm_buffer_end_access(shm_buf);
+	for (size_t i = 0; i < CLIENT_TEXTURE_POOL_CAP; i++) {
+		struct wlr_client_texture *other = &pool->textures[i];
+		if (other != tex && other->texture != NULL) {
+			pixman_region32_union(&other->damage, &other->damage,
+				&buffer_damage);
+		}
+	}
+	pixman_region32_fini(&buffer_damage);
+
+	if (tex->owner == NULL) {
+		struct wlr_client_buffer *updated =
+			client_buffer_create(tex->texture, resource, true);
+		if (updated == NULL) {
+			return NULL;
+		}
+		tex->owner = updated;
+		updated->texture_pool = pool;
+		pool->n_refs++;
+
+		// We have uploaded the data, we don't need to access the wl_buffer
+		// anymore
+		wl_buffer_send_release(resource);
+
+		// The old buffer is destroyed once the last reference is dropped
+		wlr_buffer_unlock(&buffer->base);
+		return updated;
+	}
 
 	// We have uploaded the data, we don't need to access the wl_buffer
 	// anymore
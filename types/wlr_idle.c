@@ -1,11 +1,14 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_idle.h>
 #include <wlr/util/log.h>
 #include "idle-protocol.h"
 #include "util/signal.h"
+#include "util/time.h"
 
 static const struct org_kde_kwin_idle_timeout_interface idle_timeout_impl;
 
@@ -16,28 +19,84 @@ static struct wlr_idle_timeout *idle_timeout_from_resource(
 	return wl_resource_get_user_data(resource);
 }
 
-static int idle_notify(void *data) {
-	struct wlr_idle_timeout *timer = data;
+/**
+ * Input activity of a seat. Timers don't need to be re-armed on each input
+ * event: their deadlines are computed from the last activity timestamp, and
+ * the shared timer is only updated once it fires.
+ */
+struct wlr_idle_seat {
+	struct wlr_idle *idle;
+	struct wlr_seat *seat;
+	struct wl_list link; // wlr_idle.seats
+	int64_t last_activity; // msec
+	size_t idle_timers_len; // number of timers in the idle state
+
+	struct wl_listener seat_destroy;
+};
+
+static int64_t get_current_time(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_msec(&now);
+}
+
+static int64_t timer_get_deadline(struct wlr_idle_timeout *timer) {
+	int64_t last_activity = timer->last_activity;
+	if (timer->idle_seat->last_activity > last_activity) {
+		last_activity = timer->idle_seat->last_activity;
+	}
+	return last_activity + timer->timeout;
+}
+
+/**
+ * Arms the shared timer for the earliest deadline. The timer is only updated
+ * if that deadline has changed.
+ */
+static void idle_update_timer(struct wlr_idle *idle) {
+	int64_t next_deadline = INT64_MAX;
+	struct wlr_idle_timeout *timer;
+	wl_list_for_each(timer, &idle->idle_timers, link) {
+		if (!timer->enabled || timer->idle_state) {
+			continue;
+		}
+		int64_t deadline = timer_get_deadline(timer);
+		if (deadline < next_deadline) {
+			next_deadline = deadline;
+		}
+	}
+
+	if (next_deadline == idle->next_deadline) {
+		return;
+	}
+	idle->next_deadline = next_deadline;
+
+	int delay = 0; // disarm
+	if (next_deadline != INT64_MAX) {
+		int64_t delay_ms = next_deadline - get_current_time();
+		// Zero would disarm the timer
+		delay = delay_ms > 0 ? (delay_ms < INT32_MAX ? delay_ms : INT32_MAX) : 1;
+	}
+	wl_event_source_timer_update(idle->timer_source, delay);
+}
+
+static void idle_notify(struct wlr_idle_timeout *timer) {
 	if (timer->idle_state) {
-		return 0;
+		return;
 	}
 	timer->idle_state = true;
+	timer->idle_seat->idle_timers_len++;
 	wlr_signal_emit_safe(&timer->events.idle, timer);
 
 	if (timer->resource) {
 		org_kde_kwin_idle_timeout_send_idle(timer->resource);
 	}
-	return 1;
 }
 
-static void handle_activity(struct wlr_idle_timeout *timer) {
-	if (!timer->enabled) {
-		return;
-	}
-
+static void timer_resume(struct wlr_idle_timeout *timer) {
 	// in case the previous state was sleeping send a resume event and switch state
 	if (timer->idle_state) {
 		timer->idle_state = false;
+		timer->idle_seat->idle_timers_len--;
 		wlr_signal_emit_safe(&timer->events.resume, timer);
 
 		if (timer->resource) {
@@ -45,13 +104,87 @@ static void handle_activity(struct wlr_idle_timeout *timer) {
 		}
 	}
 
-	// rearm the timer
-	wl_event_source_timer_update(timer->idle_source, timer->timeout);
 	if (timer->timeout == 0) {
 		idle_notify(timer);
 	}
 }
 
+static int idle_handle_timer(void *data) {
+	struct wlr_idle *idle = data;
+	idle->next_deadline = INT64_MAX;
+
+	int64_t now = get_current_time();
+	struct wlr_idle_timeout *timer, *tmp;
+	wl_list_for_each_safe(timer, tmp, &idle->idle_timers, link) {
+		if (timer->enabled && !timer->idle_state &&
+				timer_get_deadline(timer) <= now) {
+			idle_notify(timer);
+		}
+	}
+
+	idle_update_timer(idle);
+	return 0;
+}
+
+static void handle_activity(struct wlr_idle_timeout *timer) {
+	if (!timer->enabled) {
+		return;
+	}
+
+	bool was_idle = timer->idle_state;
+	timer->last_activity = get_current_time();
+	timer_resume(timer);
+
+	// The deadline of a running timer can only be pushed back, which is
+	// handled when the shared timer fires
+	if (was_idle) {
+		idle_update_timer(timer->idle);
+	}
+}
+
+static void idle_seat_destroy(struct wlr_idle_seat *idle_seat) {
+	wl_list_remove(&idle_seat->seat_destroy.link);
+	wl_list_remove(&idle_seat->link);
+	free(idle_seat);
+}
+
+static void idle_seat_handle_seat_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_idle_seat *idle_seat =
+		wl_container_of(listener, idle_seat, seat_destroy);
+	struct wlr_idle_timeout *timer, *tmp;
+	wl_list_for_each_safe(timer, tmp, &idle_seat->idle->idle_timers, link) {
+		if (timer->idle_seat == idle_seat) {
+			wlr_idle_timeout_destroy(timer);
+		}
+	}
+	idle_seat_destroy(idle_seat);
+}
+
+static struct wlr_idle_seat *idle_seat_get_or_create(struct wlr_idle *idle,
+		struct wlr_seat *seat) {
+	struct wlr_idle_seat *idle_seat;
+	wl_list_for_each(idle_seat, &idle->seats, link) {
+		if (idle_seat->seat == seat) {
+			return idle_seat;
+		}
+	}
+
+	idle_seat = calloc(1, sizeof(struct wlr_idle_seat));
+	if (idle_seat == NULL) {
+		return NULL;
+	}
+	idle_seat->idle = idle;
+	idle_seat->seat = seat;
+	idle_seat->last_activity = get_current_time();
+	wl_list_insert(&idle->seats, &idle_seat->link);
+
+	idle_seat->seat_destroy.notify = idle_seat_handle_seat_destroy;
+	wl_signal_add(&seat->events.destroy, &idle_seat->seat_destroy);
+
+	return idle_seat;
+}
+
 static void handle_timer_resource_destroy(struct wl_resource *timer_resource) {
 	struct wlr_idle_timeout *timer = idle_timeout_from_resource(timer_resource);
 	if (timer != NULL) {
@@ -91,15 +224,6 @@ static struct wlr_idle *idle_from_resource(
 	return wl_resource_get_user_data(resource);
 }
 
-static void handle_input_notification(struct wl_listener *listener, void *data) {
-	struct wlr_idle_timeout *timer =
-		wl_container_of(listener, timer, input_listener);
-	struct wlr_seat *seat = data;
-	if (timer->seat == seat) {
-		handle_activity(timer);
-	}
-}
-
 static struct wlr_idle_timeout *create_timer(struct wlr_idle *idle,
 		struct wlr_seat *seat, uint32_t timeout, struct wl_resource *resource) {
 	struct wlr_idle_timeout *timer =
@@ -108,10 +232,18 @@ static struct wlr_idle_timeout *create_timer(struct wlr_idle *idle,
 		return NULL;
 	}
 
+	timer->idle_seat = idle_seat_get_or_create(idle, seat);
+	if (timer->idle_seat == NULL) {
+		free(timer);
+		return NULL;
+	}
+
+	timer->idle = idle;
 	timer->seat = seat;
 	timer->timeout = timeout;
 	timer->idle_state = false;
 	timer->enabled = idle->enabled;
+	timer->last_activity = get_current_time();
 
 	wl_list_insert(&idle->idle_timers, &timer->link);
 	wl_signal_init(&timer->events.idle);
@@ -121,29 +253,16 @@ static struct wlr_idle_timeout *create_timer(struct wlr_idle *idle,
 	timer->seat_destroy.notify = handle_seat_destroy;
 	wl_signal_add(&timer->seat->events.destroy, &timer->seat_destroy);
 
-	timer->input_listener.notify = handle_input_notification;
-	wl_signal_add(&idle->events.activity_notify, &timer->input_listener);
-	// create the timer
-	timer->idle_source =
-		wl_event_loop_add_timer(idle->event_loop, idle_notify, timer);
-	if (timer->idle_source == NULL) {
-		wl_list_remove(&timer->link);
-		wl_list_remove(&timer->input_listener.link);
-		wl_list_remove(&timer->seat_destroy.link);
-		free(timer);
-		return NULL;
-	}
-
 	if (resource) {
 		timer->resource = resource;
 		wl_resource_set_user_data(resource, timer);
 	}
 
 	if (timer->enabled) {
-		// arm the timer
-		wl_event_source_timer_update(timer->idle_source, timer->timeout);
 		if (timer->timeout == 0) {
 			idle_notify(timer);
+		} else {
+			idle_update_timer(idle);
 		}
 	}
 
@@ -185,15 +304,17 @@ void wlr_idle_set_enabled(struct wlr_idle *idle, struct wlr_seat *seat,
 		enabled ? "Enabling" : "Disabling",
 		seat ? seat->name : "all seats");
 	idle->enabled = enabled;
+	int64_t now = get_current_time();
 	struct wlr_idle_timeout *timer;
 	wl_list_for_each(timer, &idle->idle_timers, link) {
 		if (seat != NULL && timer->seat != seat) {
 			continue;
 		}
-		int timeout = enabled ? timer->timeout : 0;
-		wl_event_source_timer_update(timer->idle_source, timeout);
+		// re-enabled timers start over
+		timer->last_activity = now;
 		timer->enabled = enabled;
 	}
+	idle_update_timer(idle);
 }
 
 static void idle_bind(struct wl_client *wl_client, void *data,
@@ -213,6 +334,15 @@ static void idle_bind(struct wl_client *wl_client, void *data,
 static void handle_display_destroy(struct wl_listener *listener, void *data) {
 	struct wlr_idle *idle = wl_container_of(listener, idle, display_destroy);
 	wlr_signal_emit_safe(&idle->events.destroy, idle);
+	struct wlr_idle_timeout *timer, *tmp_timer;
+	wl_list_for_each_safe(timer, tmp_timer, &idle->idle_timers, link) {
+		wlr_idle_timeout_destroy(timer);
+	}
+	struct wlr_idle_seat *idle_seat, *tmp_seat;
+	wl_list_for_each_safe(idle_seat, tmp_seat, &idle->seats, link) {
+		idle_seat_destroy(idle_seat);
+	}
+	wl_event_source_remove(idle->timer_source);
 	wl_list_remove(&idle->display_destroy.link);
 	wl_global_destroy(idle->global);
 	free(idle);
@@ -224,9 +354,11 @@ struct wlr_idle *wlr_idle_create(struct wl_display *display) {
 		return NULL;
 	}
 	wl_list_init(&idle->idle_timers);
+	wl_list_init(&idle->seats);
 	wl_signal_init(&idle->events.activity_notify);
 	wl_signal_init(&idle->events.destroy);
 	idle->enabled = true;
+	idle->next_deadline = INT64_MAX;
 
 	idle->event_loop = wl_display_get_event_loop(display);
 	if (idle->event_loop == NULL) {
@@ -234,6 +366,13 @@ struct wlr_idle *wlr_idle_create(struct wl_display *display) {
 		return NULL;
 	}
 
+	idle->timer_source =
+		wl_event_loop_add_timer(idle->event_loop, idle_handle_timer, idle);
+	if (idle->timer_source == NULL) {
+		free(idle);
+		return NULL;
+	}
+
 	idle->display_destroy.notify = handle_display_destroy;
 	wl_display_add_destroy_listener(display, &idle->display_destroy);
 
@@ -241,6 +380,7 @@ struct wlr_idle *wlr_idle_create(struct wl_display *display) {
 		1, idle, idle_bind);
 	if (idle->global == NULL) {
 		wl_list_remove(&idle->display_destroy.link);
+		wl_event_source_remove(idle->timer_source);
 		free(idle);
 		return NULL;
 	}
@@ -249,6 +389,28 @@ struct wlr_idle *wlr_idle_create(struct wl_display *display) {
 }
 
 void wlr_idle_notify_activity(struct wlr_idle *idle, struct wlr_seat *seat) {
+	struct wlr_idle_seat *idle_seat;
+	wl_list_for_each(idle_seat, &idle->seats, link) {
+		if (idle_seat->seat != seat) {
+			continue;
+		}
+
+		idle_seat->last_activity = get_current_time();
+
+		// Only timers in the idle state need to be woken up, running timers
+		// pick up the new timestamp when the shared timer fires
+		if (idle_seat->idle_timers_len > 0) {
+			struct wlr_idle_timeout *timer;
+			wl_list_for_each(timer, &idle->idle_timers, link) {
+				if (timer->idle_seat == idle_seat && timer->enabled) {
+					timer_resume(timer);
+				}
+			}
+			idle_update_timer(idle);
+		}
+		break;
+	}
+
 	wlr_signal_emit_safe(&idle->events.activity_notify, seat);
 }
 
@@ -260,9 +422,10 @@ struct wlr_idle_timeout *wlr_idle_timeout_create(struct wlr_idle *idle,
 void wlr_idle_timeout_destroy(struct wlr_idle_timeout *timer) {
 	wlr_signal_emit_safe(&timer->events.destroy, NULL);
 
-	wl_list_remove(&timer->input_listener.link);
+	if (timer->idle_state) {
+		timer->idle_seat->idle_timers_len--;
+	}
 	wl_list_remove(&timer->seat_destroy.link);
-	wl_event_source_remove(timer->idle_source);
 	wl_list_remove(&timer->link);
 
 	if (timer->resource) {
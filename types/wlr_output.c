@@ -10,6 +10,7 @@
 #include <wlr/render/interface.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_box.h>
+#include <wlr/types/wlr_linux_dmabuf_v1.h>
 #include <wlr/types/wlr_matrix.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_seat.h>
@@ -21,8 +22,10 @@
 #include "render/drm_format_set.h"
 #include "render/swapchain.h"
 #include "render/wlr_renderer.h"
+#include "types/wlr_buffer.h"
 #include "util/global.h"
 #include "util/signal.h"
+#include "util/time.h"
 #include "backend/drm/drm.h"
 
 #define OUTPUT_VERSION 3
@@ -359,6 +362,7 @@ void wlr_output_init(struct wlr_output *output, struct wlr_backend *backend,
 	output->scale = 1;
 	output->commit_seq = 0;
 	wl_list_init(&output->cursors);
+	wl_list_init(&output->cursor_buffer_cache);
 	wl_list_init(&output->resources);
 	wl_signal_init(&output->events.frame);
 	wl_signal_init(&output->events.damage);
@@ -385,6 +389,7 @@ void wlr_output_init(struct wlr_output *output, struct wlr_backend *backend,
 }
 
 static void output_clear_back_buffer(struct wlr_output *output);
+static void output_clear_cursor_buffer_cache(struct wlr_output *output);
 
 void wlr_output_destroy(struct wlr_output *output) {
 	if (!output) {
@@ -404,6 +409,7 @@ void wlr_output_destroy(struct wlr_output *output) {
 		wlr_output_cursor_destroy(cursor);
 	}
 
+	output_clear_cursor_buffer_cache(output);
 	wlr_swapchain_destroy(output->cursor_swapchain);
 	wlr_buffer_unlock(output->cursor_front_buffer);
 
@@ -417,6 +423,10 @@ void wlr_output_destroy(struct wlr_output *output) {
 		wl_event_source_remove(output->idle_done);
 	}
 
+	if (output->frame_scheduler.timer != NULL) {
+		wl_event_source_remove(output->frame_scheduler.timer);
+	}
+
 	free(output->description);
 
 	pixman_region32_fini(&output->pending.damage);
@@ -507,7 +517,7 @@ static bool output_create_swapchain(struct wlr_output *output) {
 		format->format, output->name);
 
 	output->swapchain = wlr_swapchain_create(allocator, output->width,
-		output->height, format, NULL);
+		output->height, format, output->swapchain_depth, NULL);
 	free(format);
 	if (output->swapchain == NULL) {
 		wlr_log(WLR_ERROR, "Failed to create output swapchain");
@@ -517,6 +527,28 @@ static bool output_create_swapchain(struct wlr_output *output) {
 	return true;
 }
 
+bool wlr_output_set_swapchain_depth(struct wlr_output *output, size_t depth) {
+	if (depth == 1 || depth > WLR_SWAPCHAIN_CAP) {
+		wlr_log(WLR_ERROR, "Unsupported swapchain depth %zu for output '%s'",
+			depth, output->name);
+		return false;
+	}
+
+	if (output->swapchain_depth == depth) {
+		return true;
+	}
+	if (output->back_buffer != NULL) {
+		wlr_log(WLR_ERROR, "Cannot change swapchain depth of output '%s' "
+			"while a buffer is attached", output->name);
+		return false;
+	}
+	output->swapchain_depth = depth;
+
+	wlr_swapchain_destroy(output->swapchain);
+	output->swapchain = NULL;
+	return true;
+}
+
 static bool output_attach_back_buffer(struct wlr_output *output,
 		int *buffer_age) {
 	assert(output->back_buffer == NULL);
@@ -528,12 +560,26 @@ static bool output_attach_back_buffer(struct wlr_output *output,
 	struct wlr_renderer *renderer = wlr_backend_get_renderer(output->backend);
 	assert(renderer != NULL);
 
-	struct wlr_buffer *buffer =
-		wlr_swapchain_acquire(output->swapchain, buffer_age);
+	struct wlr_swapchain *swapchain = output->swapchain;
+	struct wlr_output_swapchain_stats *stats = &output->swapchain_stats;
+	size_t allocations = swapchain->allocations;
+	int age = 0;
+	struct wlr_buffer *buffer = wlr_swapchain_acquire(swapchain, &age);
+	stats->allocations += swapchain->allocations - allocations;
 	if (buffer == NULL) {
+		stats->acquire_failures++;
 		return false;
 	}
 
+	size_t bucket = age > 0 ? (size_t)age : 0;
+	if (bucket >= WLR_OUTPUT_BUFFER_AGE_BUCKETS) {
+		bucket = WLR_OUTPUT_BUFFER_AGE_BUCKETS - 1;
+	}
+	stats->buffer_ages[bucket]++;
+	if (buffer_age != NULL) {
+		*buffer_age = age;
+	}
+
 	if (!renderer_bind_buffer(renderer, buffer)) {
 		wlr_buffer_unlock(buffer);
 		return false;
@@ -643,6 +689,104 @@ static void output_pending_resolution(struct wlr_output *output, int *width,
 	}
 }
 
+static int64_t output_get_time_nsec(struct wlr_output *output) {
+	clockid_t clock = wlr_backend_get_presentation_clock(output->backend);
+	struct timespec now;
+	clock_gettime(clock, &now);
+	return timespec_to_nsec(&now);
+}
+
+static void frame_scheduler_add_render_time(
+		struct wlr_output_frame_scheduler *sched, int64_t render_time) {
+	sched->render_times[sched->render_times_next] = render_time;
+	sched->render_times_next =
+		(sched->render_times_next + 1) % WLR_OUTPUT_RENDER_TIME_SAMPLES;
+	if (sched->render_times_len < WLR_OUTPUT_RENDER_TIME_SAMPLES) {
+		sched->render_times_len++;
+	}
+}
+
+/**
+ * Predicts the render time of the next frame: the slowest of the recent
+ * frames.
+ */
+static int64_t frame_scheduler_predict(
+		const struct wlr_output_frame_scheduler *sched) {
+	int64_t max = 0;
+	for (size_t i = 0; i < sched->render_times_len; i++) {
+		if (sched->render_times[i] > max) {
+			max = sched->render_times[i];
+		}
+	}
+	return max;
+}
+
+static void output_cancel_scheduled_frame(struct wlr_output *output) {
+	struct wlr_output_frame_scheduler *sched = &output->frame_scheduler;
+	if (sched->scheduled) {
+		wl_event_source_timer_update(sched->timer, 0);
+		sched->scheduled = false;
+	}
+}
+
+static void frame_scheduler_handle_commit(struct wlr_output *output) {
+	struct wlr_output_frame_scheduler *sched = &output->frame_scheduler;
+	if (!sched->enabled) {
+		return;
+	}
+
+	int64_t now = output_get_time_nsec(output);
+	if (sched->frame_time != 0) {
+		// Ignore commits made long after the frame event, e.g. because the
+		// compositor had nothing to render at that time
+		int64_t render_time = now - sched->frame_time;
+		if (sched->refresh <= 0 || render_time < sched->refresh) {
+			frame_scheduler_add_render_time(sched, render_time);
+		}
+		sched->frame_time = 0;
+	}
+
+	// Remember which vblank this frame should make it to
+	sched->deadline = 0;
+	if (sched->refresh > 0 && sched->last_present != 0 &&
+			now >= sched->last_present) {
+		sched->deadline = sched->last_present +
+			((now - sched->last_present) / sched->refresh + 1) * sched->refresh;
+		// The frame will be counted once committed
+		sched->deadline_commit_seq = output->commit_seq + 1;
+	}
+}
+
+static void frame_scheduler_handle_present(struct wlr_output *output,
+		const struct wlr_output_event_present *event) {
+	struct wlr_output_frame_scheduler *sched = &output->frame_scheduler;
+
+	int64_t refresh = event->refresh;
+	if (refresh <= 0 && output->refresh > 0) {
+		refresh = 1000000000000LL / output->refresh;
+	}
+	sched->refresh = refresh;
+	sched->last_present = timespec_to_nsec(event->when);
+
+	if (!sched->enabled || sched->deadline == 0 ||
+			event->commit_seq != sched->deadline_commit_seq) {
+		return;
+	}
+
+	// Allow for some clock jitter between the prediction and the hardware
+	if (refresh > 0 && sched->last_present > sched->deadline + refresh / 2) {
+		sched->missed_deadlines++;
+		// Back off: assume the next frame will be twice as slow as the worst
+		// recent one, without exceeding a whole refresh period
+		int64_t render_time = 2 * frame_scheduler_predict(sched);
+		if (render_time > refresh) {
+			render_time = refresh;
+		}
+		frame_scheduler_add_render_time(sched, render_time);
+	}
+	sched->deadline = 0;
+}
+
 static bool output_basic_test(struct wlr_output *output) {
 	if (output->pending.committed & WLR_OUTPUT_STATE_BUFFER) {
 		if (output->frame_pending) {
@@ -727,6 +871,10 @@ bool wlr_output_commit(struct wlr_output *output) {
 		wl_event_source_remove(output->idle_frame);
 		output->idle_frame = NULL;
 	}
+	if (output->pending.committed & WLR_OUTPUT_STATE_BUFFER) {
+		// The compositor didn't wait for the delayed frame event
+		output_cancel_scheduled_frame(output);
+	}
 
 	struct timespec now;
 	clock_gettime(CLOCK_MONOTONIC, &now);
@@ -743,7 +891,18 @@ bool wlr_output_commit(struct wlr_output *output) {
 		return false;
 	}
 
+	struct wlr_buffer *buffer = NULL;
 	if (output->pending.committed & WLR_OUTPUT_STATE_BUFFER) {
+		frame_scheduler_handle_commit(output);
+
+		// Keep the buffer alive until the commit event has been emitted
+		buffer = output->pending.buffer_type ==
+			WLR_OUTPUT_STATE_BUFFER_SCANOUT ?
+			output->pending.buffer : output->back_buffer;
+		if (buffer != NULL) {
+			wlr_buffer_lock(buffer);
+		}
+
 		struct wlr_output_cursor *cursor;
 		wl_list_for_each(cursor, &output->cursors, link) {
 			if (!cursor->enabled || !cursor->visible || cursor->surface == NULL) {
@@ -798,9 +957,14 @@ bool wlr_output_commit(struct wlr_output *output) {
 		.output = output,
 		.committed = committed,
 		.when = &now,
+		.buffer = buffer,
 	};
 	wlr_signal_emit_safe(&output->events.commit, &event);
 
+	if (buffer != NULL) {
+		wlr_buffer_unlock(buffer);
+	}
+
 	return true;
 }
 
@@ -823,26 +987,175 @@ void wlr_output_attach_buffer(struct wlr_output *output,
 	output->pending.buffer = wlr_buffer_lock(buffer);
 }
 
+bool wlr_output_attach_surface_scanout(struct wlr_output *output,
+		struct wlr_surface *surface) {
+	if (!output->enabled ||
+			(output->pending.committed & WLR_OUTPUT_STATE_BUFFER)) {
+		return false;
+	}
+	if (surface->buffer == NULL) {
+		return false;
+	}
+
+	// Software cursors are drawn on top of the primary buffer
+	struct wlr_output_cursor *cursor;
+	wl_list_for_each(cursor, &output->cursors, link) {
+		if (cursor->enabled && cursor->visible &&
+				output->hardware_cursor != cursor) {
+			return false;
+		}
+	}
+
+	// Sub-surfaces would need to be composited on top of the buffer
+	if (!wl_list_empty(&surface->subsurfaces_below) ||
+			!wl_list_empty(&surface->subsurfaces_above)) {
+		return false;
+	}
+
+	// The buffer needs to be displayable as-is: same transform, no cropping,
+	// and exactly covering the output once scaled
+	struct wlr_surface_state *state = &surface->current;
+	if (state->transform != output->transform || state->viewport.has_src) {
+		return false;
+	}
+	if (state->buffer_width != output->width ||
+			state->buffer_height != output->height) {
+		return false;
+	}
+	int width, height;
+	wlr_output_effective_resolution(output, &width, &height);
+	if (state->width != width || state->height != height) {
+		return false;
+	}
+
+	// Nothing may show through the buffer
+	pixman_box32_t surface_box = {
+		.x2 = state->width,
+		.y2 = state->height,
+	};
+	if (pixman_region32_contains_rectangle(&surface->opaque_region,
+			&surface_box) != PIXMAN_REGION_IN) {
+		return false;
+	}
+
+	struct wlr_buffer *buffer = &surface->buffer->base;
+	struct wlr_dmabuf_attributes attribs;
+	if (!wlr_buffer_get_dmabuf(buffer, &attribs)) {
+		return false;
+	}
+	if (output->impl->get_primary_formats) {
+		const struct wlr_drm_format_set *formats =
+			output->impl->get_primary_formats(output, WLR_BUFFER_CAP_DMABUF);
+		if (formats == NULL || !wlr_drm_format_set_has(formats,
+				attribs.format, attribs.modifier)) {
+			return false;
+		}
+	}
+
+	wlr_output_attach_buffer(output, buffer);
+	if (!wlr_output_test(output)) {
+		output_state_clear_buffer(&output->pending);
+		return false;
+	}
+
+	return true;
+}
+
+static void output_emit_frame(struct wlr_output *output) {
+	struct wlr_output_frame_scheduler *sched = &output->frame_scheduler;
+	if (sched->enabled) {
+		sched->frame_time = output_get_time_nsec(output);
+	}
+	wlr_signal_emit_safe(&output->events.frame, output);
+}
+
+static int frame_scheduler_handle_timer(void *data) {
+	struct wlr_output *output = data;
+	output->frame_scheduler.scheduled = false;
+	if (output->enabled && !output->frame_pending) {
+		output_emit_frame(output);
+	}
+	return 0;
+}
+
+/**
+ * Returns how many milliseconds the frame event should be delayed by, or zero
+ * to send it right away.
+ */
+static int frame_scheduler_get_delay(struct wlr_output *output) {
+	struct wlr_output_frame_scheduler *sched = &output->frame_scheduler;
+	if (!sched->enabled || sched->refresh <= 0 || sched->last_present == 0 ||
+			sched->render_times_len == 0) {
+		// Without a prediction, play it safe
+		return 0;
+	}
+
+	int64_t now = output_get_time_nsec(output);
+	int64_t next_vblank = sched->last_present;
+	if (now >= next_vblank) {
+		next_vblank += ((now - next_vblank) / sched->refresh + 1) *
+			sched->refresh;
+	}
+
+	int64_t deadline = next_vblank - frame_scheduler_predict(sched) -
+		sched->margin;
+	int64_t delay_msec = (deadline - now) / 1000000;
+	return delay_msec > 0 ? (int)delay_msec : 0;
+}
+
 void wlr_output_send_frame(struct wlr_output *output) {
 	output->frame_pending = false;
-	wlr_signal_emit_safe(&output->events.frame, output);
+
+	struct wlr_output_frame_scheduler *sched = &output->frame_scheduler;
+	int delay = frame_scheduler_get_delay(output);
+	if (delay > 0) {
+		if (sched->timer == NULL) {
+			struct wl_event_loop *ev = wl_display_get_event_loop(output->display);
+			sched->timer = wl_event_loop_add_timer(ev,
+				frame_scheduler_handle_timer, output);
+		}
+		if (sched->timer != NULL &&
+				wl_event_source_timer_update(sched->timer, delay) == 0) {
+			sched->scheduled = true;
+			return;
+		}
+		wlr_log(WLR_ERROR, "Failed to delay frame event");
+	}
+
+	output_emit_frame(output);
 }
 
 static void schedule_frame_handle_idle_timer(void *data) {
 	struct wlr_output *output = data;
 	output->idle_frame = NULL;
-	if (!output->frame_pending) {
+	if (!output->frame_pending && !output->frame_scheduler.scheduled) {
 		wlr_output_send_frame(output);
 	}
 }
 
+void wlr_output_set_frame_scheduling(struct wlr_output *output, bool enabled,
+		int64_t margin_nsec) {
+	struct wlr_output_frame_scheduler *sched = &output->frame_scheduler;
+	sched->enabled = enabled;
+	sched->margin = margin_nsec;
+	sched->frame_time = 0;
+	sched->render_times_len = 0;
+	sched->render_times_next = 0;
+
+	if (!enabled && sched->scheduled) {
+		output_cancel_scheduled_frame(output);
+		output_emit_frame(output);
+	}
+}
+
 void wlr_output_schedule_frame(struct wlr_output *output) {
 	// Make sure the compositor commits a new frame. This is necessary to make
 	// clients which ask for frame callbacks without submitting a new buffer
 	// work.
 	wlr_output_update_needs_frame(output);
 
-	if (output->frame_pending || output->idle_frame != NULL) {
+	if (output->frame_pending || output->idle_frame != NULL ||
+			output->frame_scheduler.scheduled) {
 		return;
 	}
 
@@ -875,6 +1188,8 @@ void wlr_output_send_present(struct wlr_output *output,
 		event->when = &now;
 	}
 
+	frame_scheduler_handle_present(output, event);
+
 	wlr_signal_emit_safe(&output->events.present, event);
 }
 
@@ -1200,6 +1515,114 @@ static struct wlr_drm_format *output_pick_cursor_format(struct wlr_output *outpu
 	return output_pick_format(output, display_formats);
 }
 
+/**
+ * Rendered cursor buffers are kept around, keyed by the cursor image and the
+ * parameters used to render it, so that switching back to a known cursor
+ * doesn't require rendering it again. The cache entries hold a lock on their
+ * buffer, so the cache must leave at least one cursor swapchain slot free.
+ */
+#define CURSOR_BUFFER_CACHE_SIZE (WLR_SWAPCHAIN_CAP - 1)
+
+struct output_cursor_buffer {
+	struct wl_list link; // wlr_output.cursor_buffer_cache
+	struct wlr_buffer *buffer;
+
+	uint64_t texture_hash;
+	void *texture_pixels; // owned by the cache entry, ARGB8888 without padding
+	int texture_width, texture_height;
+	float scale;
+	enum wl_output_transform transform;
+	float output_scale;
+	enum wl_output_transform output_transform;
+};
+
+static void output_cursor_buffer_destroy(struct output_cursor_buffer *entry) {
+	wl_list_remove(&entry->link);
+	wlr_buffer_unlock(entry->buffer);
+	free(entry->texture_pixels);
+	free(entry);
+}
+
+static void output_clear_cursor_buffer_cache(struct wlr_output *output) {
+	struct output_cursor_buffer *entry, *tmp;
+	wl_list_for_each_safe(entry, tmp, &output->cursor_buffer_cache, link) {
+		output_cursor_buffer_destroy(entry);
+	}
+}
+
+static struct output_cursor_buffer *output_find_cursor_buffer(
+		struct wlr_output *output, const struct output_cursor_buffer *key) {
+	struct output_cursor_buffer *entry;
+	wl_list_for_each(entry, &output->cursor_buffer_cache, link) {
+		if (entry->texture_hash == key->texture_hash &&
+				entry->texture_width == key->texture_width &&
+				entry->texture_height == key->texture_height &&
+				entry->scale == key->scale &&
+				entry->transform == key->transform &&
+				entry->output_scale == key->output_scale &&
+				entry->output_transform == key->output_transform &&
+				memcmp(entry->texture_pixels, key->texture_pixels,
+					(size_t)key->texture_width * key->texture_height * 4) == 0) {
+			// The hash only rules out most mismatches quickly
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void output_add_cursor_buffer(struct wlr_output *output,
+		const struct output_cursor_buffer *key, struct wlr_buffer *buffer) {
+	if (wl_list_length(&output->cursor_buffer_cache) >=
+			CURSOR_BUFFER_CACHE_SIZE) {
+		struct output_cursor_buffer *oldest = wl_container_of(
+			output->cursor_buffer_cache.prev, oldest, link);
+		output_cursor_buffer_destroy(oldest);
+	}
+
+	struct output_cursor_buffer *entry = calloc(1, sizeof(*entry));
+	if (entry == NULL) {
+		return;
+	}
+	*entry = *key;
+	size_t size = (size_t)key->texture_width * key->texture_height * 4;
+	entry->texture_pixels = malloc(size);
+	if (entry->texture_pixels == NULL) {
+		free(entry);
+		return;
+	}
+	memcpy(entry->texture_pixels, key->texture_pixels, size);
+	entry->buffer = wlr_buffer_lock(buffer);
+	wl_list_insert(&output->cursor_buffer_cache, &entry->link);
+}
+
+static void *copy_cursor_pixels(const uint8_t *pixels, int32_t stride,
+		uint32_t width, uint32_t height) {
+	size_t row_size = (size_t)width * 4;
+	uint8_t *copy = malloc(row_size * height);
+	if (copy == NULL) {
+		return NULL;
+	}
+	for (uint32_t y = 0; y < height; y++) {
+		memcpy(copy + y * row_size, pixels + (size_t)y * stride, row_size);
+	}
+	return copy;
+}
+
+static uint64_t hash_cursor_pixels(const void *pixels, uint32_t width,
+		uint32_t height) {
+	// 64-bit FNV-1a over whole pixels
+	uint64_t hash = 0xcbf29ce484222325;
+	const uint8_t *bytes = pixels;
+	size_t len = (size_t)width * height;
+	for (size_t i = 0; i < len; i++) {
+		uint32_t px;
+		memcpy(&px, bytes + i * sizeof(px), sizeof(px));
+		hash ^= px;
+		hash *= 0x100000001b3;
+	}
+	return hash != 0 ? hash : 1;
+}
+
 static struct wlr_buffer *render_cursor_buffer(struct wlr_output_cursor *cursor) {
 	struct wlr_output *output = cursor->output;
 
@@ -1250,17 +1673,46 @@ static struct wlr_buffer *render_cursor_buffer(struct wlr_output_cursor *cursor)
 			return NULL;
 		}
 
+		output_clear_cursor_buffer_cache(output);
 		wlr_swapchain_destroy(output->cursor_swapchain);
 		output->cursor_swapchain = wlr_swapchain_create(allocator,
-			width, height, format, NULL);
+			width, height, format, 0, NULL);
 		if (output->cursor_swapchain == NULL) {
 			wlr_log(WLR_ERROR, "Failed to create cursor swapchain");
 			return NULL;
 		}
 	}
 
+	// Surface contents may change without the texture changing, so only
+	// images set via wlr_output_cursor_set_image are cached
+	struct output_cursor_buffer key = {
+		.texture_hash = cursor->surface == NULL ? cursor->texture_hash : 0,
+		.texture_pixels = cursor->texture_pixels,
+		.texture_width = texture->width,
+		.texture_height = texture->height,
+		.scale = scale,
+		.transform = transform,
+		.output_scale = output->scale,
+		.output_transform = output->transform,
+	};
+	if (key.texture_hash != 0) {
+		struct output_cursor_buffer *entry =
+			output_find_cursor_buffer(output, &key);
+		if (entry != NULL) {
+			wl_list_remove(&entry->link);
+			wl_list_insert(&output->cursor_buffer_cache, &entry->link);
+			return wlr_buffer_lock(entry->buffer);
+		}
+	}
+
 	struct wlr_buffer *buffer =
 		wlr_swapchain_acquire(output->cursor_swapchain, NULL);
+	if (buffer == NULL &&
+			!wl_list_empty(&output->cursor_buffer_cache)) {
+		// All slots may be held by the cache
+		output_clear_cursor_buffer_cache(output);
+		buffer = wlr_swapchain_acquire(output->cursor_swapchain, NULL);
+	}
 	if (buffer == NULL) {
 		return NULL;
 	}
@@ -1299,9 +1751,77 @@ static struct wlr_buffer *render_cursor_buffer(struct wlr_output_cursor *cursor)
 
 	wlr_renderer_end(renderer);
 
+	if (key.texture_hash != 0) {
+		output_add_cursor_buffer(output, &key, buffer);
+	}
+
 	return buffer;
 }
 
+/**
+ * Returns the cursor surface's buffer if it can be scanned out as-is by the
+ * cursor plane, without being copied into a cursor swapchain buffer.
+ */
+static struct wlr_buffer *output_cursor_get_direct_buffer(
+		struct wlr_output_cursor *cursor) {
+	struct wlr_output *output = cursor->output;
+	struct wlr_surface *surface = cursor->surface;
+
+	struct wlr_client_buffer *client_buffer = surface->buffer;
+	if (client_buffer == NULL || client_buffer->resource == NULL ||
+			!wlr_dmabuf_v1_resource_is_buffer(client_buffer->resource)) {
+		return NULL;
+	}
+
+	if (output->transform != WL_OUTPUT_TRANSFORM_NORMAL ||
+			surface->current.transform != WL_OUTPUT_TRANSFORM_NORMAL ||
+			(float)surface->current.scale != output->scale) {
+		return NULL;
+	}
+
+	// The cursor plane can't crop nor pad the buffer
+	if (output->impl->get_cursor_size) {
+		int width = client_buffer->base.width;
+		int height = client_buffer->base.height;
+		output->impl->get_cursor_size(output, &width, &height);
+		if (width != client_buffer->base.width ||
+				height != client_buffer->base.height) {
+			return NULL;
+		}
+	}
+
+	// The client buffer exposes the DMA-BUF of its resource, and holding a
+	// lock on it keeps the wl_buffer from being released while it's on screen
+	return wlr_buffer_lock(&client_buffer->base);
+}
+
+/**
+ * Sets the buffer of the hardware cursor. Takes ownership of the buffer lock.
+ */
+static bool output_cursor_set_hardware_buffer(struct wlr_output_cursor *cursor,
+		struct wlr_buffer *buffer) {
+	struct wlr_output *output = cursor->output;
+
+	struct wlr_box hotspot = {
+		.x = cursor->hotspot_x,
+		.y = cursor->hotspot_y,
+	};
+	wlr_box_transform(&hotspot, &hotspot,
+		wlr_output_transform_invert(output->transform),
+		buffer ? buffer->width : 0, buffer ? buffer->height : 0);
+
+	bool ok = output->impl->set_cursor(cursor->output, buffer,
+		hotspot.x, hotspot.y);
+	if (ok) {
+		wlr_buffer_unlock(output->cursor_front_buffer);
+		output->cursor_front_buffer = buffer;
+		output->hardware_cursor = cursor;
+	} else {
+		wlr_buffer_unlock(buffer);
+	}
+	return ok;
+}
+
 static bool output_cursor_attempt_hardware(struct wlr_output_cursor *cursor) {
 	struct wlr_output *output = cursor->output;
 
@@ -1317,7 +1837,6 @@ static bool output_cursor_attempt_hardware(struct wlr_output_cursor *cursor) {
 
 	struct wlr_texture *texture = cursor->texture;
 	if (cursor->surface != NULL) {
-		// TODO: try using the surface buffer directly
 		texture = wlr_surface_get_texture(cursor->surface);
 	}
 
@@ -1326,6 +1845,19 @@ static bool output_cursor_attempt_hardware(struct wlr_output_cursor *cursor) {
 	output->impl->move_cursor(cursor->output,
 		(int)cursor->x, (int)cursor->y);
 
+	if (cursor->surface != NULL && texture != NULL) {
+		struct wlr_buffer *buffer = output_cursor_get_direct_buffer(cursor);
+		if (buffer != NULL) {
+			if (output_cursor_set_hardware_buffer(cursor, buffer)) {
+				wlr_log(WLR_DEBUG, "Scanning out cursor surface buffer "
+					"directly on output '%s'", output->name);
+				return true;
+			}
+			wlr_log(WLR_DEBUG, "Failed to scan out cursor surface buffer, "
+				"falling back to rendering");
+		}
+	}
+
 	struct wlr_buffer *buffer = NULL;
 	if (texture != NULL) {
 		buffer = render_cursor_buffer(cursor);
@@ -1335,24 +1867,7 @@ static bool output_cursor_attempt_hardware(struct wlr_output_cursor *cursor) {
 		}
 	}
 
-	struct wlr_box hotspot = {
-		.x = cursor->hotspot_x,
-		.y = cursor->hotspot_y,
-	};
-	wlr_box_transform(&hotspot, &hotspot,
-		wlr_output_transform_invert(output->transform),
-		buffer ? buffer->width : 0, buffer ? buffer->height : 0);
-
-	bool ok = output->impl->set_cursor(cursor->output, buffer,
-		hotspot.x, hotspot.y);
-	if (ok) {
-		wlr_buffer_unlock(output->cursor_front_buffer);
-		output->cursor_front_buffer = buffer;
-		output->hardware_cursor = cursor;
-	} else {
-		wlr_buffer_unlock(buffer);
-	}
-	return ok;
+	return output_cursor_set_hardware_buffer(cursor, buffer);
 }
 
 bool wlr_output_cursor_set_image(struct wlr_output_cursor *cursor,
@@ -1376,6 +1891,9 @@ bool wlr_output_cursor_set_image(struct wlr_output_cursor *cursor,
 
 	wlr_texture_destroy(cursor->texture);
 	cursor->texture = NULL;
+	free(cursor->texture_pixels);
+	cursor->texture_pixels = NULL;
+	cursor->texture_hash = 0;
 
 	cursor->enabled = false;
 	if (pixels != NULL) {
@@ -1384,6 +1902,13 @@ bool wlr_output_cursor_set_image(struct wlr_output_cursor *cursor,
 		if (cursor->texture == NULL) {
 			return false;
 		}
+		// The cache is skipped when the copy can't be made
+		cursor->texture_pixels =
+			copy_cursor_pixels(pixels, stride, width, height);
+		if (cursor->texture_pixels != NULL) {
+			cursor->texture_hash =
+				hash_cursor_pixels(cursor->texture_pixels, width, height);
+		}
 		cursor->enabled = true;
 	}
 
@@ -1557,6 +2082,7 @@ void wlr_output_cursor_destroy(struct wlr_output_cursor *cursor) {
 		cursor->output->hardware_cursor = NULL;
 	}
 	wlr_texture_destroy(cursor->texture);
+	free(cursor->texture_pixels);
 	wl_list_remove(&cursor->link);
 	free(cursor);
 }
@@ -5,6 +5,7 @@
 #include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_output_damage.h>
 #include <wlr/types/wlr_output.h>
+#include <wlr/util/region.h>
 #include "util/signal.h"
 
 static void output_handle_destroy(struct wl_listener *listener, void *data) {
@@ -85,6 +86,8 @@ static void output_handle_commit(struct wl_listener *listener, void *data) {
 		// accumulate render-buffer damage
 		prev = &output_damage->previous[output_damage->previous_idx];
 		pixman_region32_union(prev, prev, &output_damage->current);
+		// Keep the history cheap to accumulate
+		wlr_region_simplify(prev, prev, output_damage->max_rects);
 		break;
 	}
 
@@ -174,13 +177,9 @@ bool wlr_output_damage_attach_render(struct wlr_output_damage *output_damage,
 			pixman_region32_union(damage, damage, &output_damage->previous[j]);
 		}
 
-		// Check the number of rectangles
-		int n_rects = pixman_region32_n_rects(damage);
-		if (n_rects > output_damage->max_rects) {
-			pixman_box32_t *extents = pixman_region32_extents(damage);
-			pixman_region32_union_rect(damage, damage, extents->x1, extents->y1,
-				extents->x2 - extents->x1, extents->y2 - extents->y1);
-		}
+		// Merge fragmented damage into a few larger rectangles, which are
+		// cheaper to repaint
+		wlr_region_simplify(damage, damage, output_damage->max_rects);
 	}
 
 	return true;
@@ -219,3 +218,9 @@ void wlr_output_damage_add_box(struct wlr_output_damage *output_damage,
 		&output_damage->current, 0, 0, width, height);
 	wlr_output_schedule_frame(output_damage->output);
 }
+
+void wlr_output_damage_subtract_opaque(struct wlr_output_damage *output_damage,
+		pixman_region32_t *opaque) {
+	pixman_region32_subtract(&output_damage->current,
+		&output_damage->current, opaque);
+}
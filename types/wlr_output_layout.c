@@ -6,10 +6,39 @@
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/util/log.h>
+#include "util/hash_table.h"
 #include "util/signal.h"
 
+struct output_layout_index_entry {
+	struct wlr_output_layout_output *l_output;
+	struct wlr_box box;
+};
+
+/**
+ * Spatial index of the layout, rebuilt whenever the layout is reconfigured.
+ *
+ * The output edges split the layout into a grid of cells, each of which is
+ * covered by the same set of outputs. Point queries are two binary searches
+ * in the edges, box queries use prefix sums of the covered cells.
+ */
+struct output_layout_index {
+	bool valid;
+
+	int *xs, *ys; // sorted, distinct output edges
+	size_t xs_len, ys_len;
+	// (xs_len - 1) * (ys_len - 1) cells in row-major order, holding the first
+	// output of the layout list covering the cell, or NULL
+	struct wlr_output_layout_output **cells;
+	// xs_len * ys_len prefix sums: covered[j * xs_len + i] is the number of
+	// covered cells in columns [0, i) and rows [0, j)
+	size_t *covered;
+};
+
 struct wlr_output_layout_state {
 	struct wlr_box _box; // should never be read directly, use the getter
+
+	struct output_layout_index index;
+	struct hash_table outputs; // wlr_output -> wlr_output_layout_output
 };
 
 struct wlr_output_layout_output_state {
@@ -36,6 +65,7 @@ struct wlr_output_layout *wlr_output_layout_create(void) {
 		return NULL;
 	}
 	wl_list_init(&layout->outputs);
+	hash_table_init(&layout->state->outputs);
 
 	wl_signal_init(&layout->events.add);
 	wl_signal_init(&layout->events.change);
@@ -44,9 +74,21 @@ struct wlr_output_layout *wlr_output_layout_create(void) {
 	return layout;
 }
 
+static void output_layout_index_finish(struct output_layout_index *index) {
+	free(index->xs);
+	free(index->ys);
+	free(index->cells);
+	free(index->covered);
+	*index = (struct output_layout_index){0};
+}
+
 static void output_layout_output_destroy(
 		struct wlr_output_layout_output *l_output) {
+	struct wlr_output_layout_state *layout_state = l_output->state->layout->state;
 	wlr_signal_emit_safe(&l_output->events.destroy, l_output);
+	// The index is rebuilt when the layout is reconfigured
+	output_layout_index_finish(&layout_state->index);
+	hash_table_remove(&layout_state->outputs, (uintptr_t)l_output->output);
 	wlr_output_destroy_global(l_output->output);
 	wl_list_remove(&l_output->state->mode.link);
 	wl_list_remove(&l_output->state->commit.link);
@@ -68,6 +110,8 @@ void wlr_output_layout_destroy(struct wlr_output_layout *layout) {
 		output_layout_output_destroy(l_output);
 	}
 
+	output_layout_index_finish(&layout->state->index);
+	hash_table_finish(&layout->state->outputs);
 	free(layout->state);
 	free(layout);
 }
@@ -83,6 +127,182 @@ static struct wlr_box *output_layout_output_get_box(
 	return &l_output->state->_box;
 }
 
+static int compare_int(const void *a, const void *b) {
+	int x = *(const int *)a, y = *(const int *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Sorts the edges and removes duplicates, returns the new length.
+ */
+static size_t sort_edges(int *edges, size_t len) {
+	if (len == 0) {
+		return 0;
+	}
+	qsort(edges, len, sizeof(edges[0]), compare_int);
+	size_t n = 1;
+	for (size_t i = 1; i < len; i++) {
+		if (edges[i] != edges[n - 1]) {
+			edges[n++] = edges[i];
+		}
+	}
+	return n;
+}
+
+/**
+ * Returns the number of edges lower than or equal to v.
+ */
+static size_t edges_upper_bound(const int *edges, size_t len, double v) {
+	size_t lo = 0, hi = len;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (edges[mid] <= v) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/**
+ * Returns the number of edges strictly lower than v.
+ */
+static size_t edges_lower_bound(const int *edges, size_t len, double v) {
+	size_t lo = 0, hi = len;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (edges[mid] < v) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static void output_layout_index_build(struct wlr_output_layout *layout) {
+	struct output_layout_index *index = &layout->state->index;
+	output_layout_index_finish(index);
+
+	size_t len = wl_list_length(&layout->outputs);
+	// Allocate one extra element so that empty layouts don't need special
+	// handling
+	struct output_layout_index_entry *entries =
+		calloc(len + 1, sizeof(entries[0]));
+	size_t entries_len = 0;
+	index->xs = calloc(2 * len + 1, sizeof(index->xs[0]));
+	index->ys = calloc(2 * len + 1, sizeof(index->ys[0]));
+	if (entries == NULL || index->xs == NULL || index->ys == NULL) {
+		goto error;
+	}
+
+	struct wlr_output_layout_output *l_output;
+	wl_list_for_each(l_output, &layout->outputs, link) {
+		struct output_layout_index_entry *entry = &entries[entries_len++];
+		entry->l_output = l_output;
+		entry->box = *output_layout_output_get_box(l_output);
+		if (wlr_box_empty(&entry->box)) {
+			continue;
+		}
+		index->xs[index->xs_len++] = entry->box.x;
+		index->xs[index->xs_len++] = entry->box.x + entry->box.width;
+		index->ys[index->ys_len++] = entry->box.y;
+		index->ys[index->ys_len++] = entry->box.y + entry->box.height;
+	}
+	index->xs_len = sort_edges(index->xs, index->xs_len);
+	index->ys_len = sort_edges(index->ys, index->ys_len);
+
+	size_t cols = index->xs_len > 0 ? index->xs_len - 1 : 0;
+	size_t rows = index->ys_len > 0 ? index->ys_len - 1 : 0;
+	index->cells = calloc(cols * rows + 1, sizeof(index->cells[0]));
+	index->covered = calloc(index->xs_len * index->ys_len + 1,
+		sizeof(index->covered[0]));
+	if (index->cells == NULL || index->covered == NULL) {
+		goto error;
+	}
+
+	for (size_t k = 0; k < entries_len; k++) {
+		struct output_layout_index_entry *entry = &entries[k];
+		if (wlr_box_empty(&entry->box)) {
+			continue;
+		}
+		size_t i0 = edges_lower_bound(index->xs, index->xs_len, entry->box.x);
+		size_t i1 = edges_lower_bound(index->xs, index->xs_len,
+			entry->box.x + entry->box.width);
+		size_t j0 = edges_lower_bound(index->ys, index->ys_len, entry->box.y);
+		size_t j1 = edges_lower_bound(index->ys, index->ys_len,
+			entry->box.y + entry->box.height);
+		for (size_t j = j0; j < j1; j++) {
+			for (size_t i = i0; i < i1; i++) {
+				// Earlier outputs in the list take precedence
+				if (index->cells[j * cols + i] == NULL) {
+					index->cells[j * cols + i] = entry->l_output;
+				}
+			}
+		}
+	}
+
+	for (size_t j = 1; j < index->ys_len; j++) {
+		for (size_t i = 1; i < index->xs_len; i++) {
+			size_t cell = index->cells[(j - 1) * cols + (i - 1)] != NULL;
+			index->covered[j * index->xs_len + i] = cell +
+				index->covered[(j - 1) * index->xs_len + i] +
+				index->covered[j * index->xs_len + i - 1] -
+				index->covered[(j - 1) * index->xs_len + i - 1];
+		}
+	}
+
+	free(entries);
+	index->valid = true;
+	return;
+
+error:
+	wlr_log(WLR_ERROR, "Failed to allocate output layout index");
+	free(entries);
+	output_layout_index_finish(index);
+}
+
+static struct wlr_output_layout_output *output_layout_index_output_at(
+		struct output_layout_index *index, double lx, double ly) {
+	size_t i = edges_upper_bound(index->xs, index->xs_len, lx);
+	size_t j = edges_upper_bound(index->ys, index->ys_len, ly);
+	if (i == 0 || i >= index->xs_len || j == 0 || j >= index->ys_len) {
+		return NULL;
+	}
+	return index->cells[(j - 1) * (index->xs_len - 1) + (i - 1)];
+}
+
+static bool output_layout_index_intersects(struct output_layout_index *index,
+		const struct wlr_box *box) {
+	if (wlr_box_empty(box) || index->xs_len == 0 || index->ys_len == 0) {
+		return false;
+	}
+
+	// Columns [i0, i1) and rows [j0, j1) overlap with the box
+	size_t i0 = edges_upper_bound(index->xs, index->xs_len, box->x);
+	size_t i1 = edges_lower_bound(index->xs, index->xs_len, box->x + box->width);
+	size_t j0 = edges_upper_bound(index->ys, index->ys_len, box->y);
+	size_t j1 = edges_lower_bound(index->ys, index->ys_len, box->y + box->height);
+	i0 = i0 > 0 ? i0 - 1 : 0;
+	j0 = j0 > 0 ? j0 - 1 : 0;
+	if (i1 > index->xs_len - 1) {
+		i1 = index->xs_len - 1;
+	}
+	if (j1 > index->ys_len - 1) {
+		j1 = index->ys_len - 1;
+	}
+	if (i0 >= i1 || j0 >= j1) {
+		return false;
+	}
+
+	size_t stride = index->xs_len;
+	size_t covered = index->covered[j1 * stride + i1] -
+		index->covered[j0 * stride + i1] - index->covered[j1 * stride + i0] +
+		index->covered[j0 * stride + i0];
+	return covered > 0;
+}
+
 /**
  * This must be called whenever the layout changes to reconfigure the auto
  * configured outputs and emit the `changed` event.
@@ -125,6 +345,8 @@ static void output_layout_reconfigure(struct wlr_output_layout *layout) {
 		max_x += box->width;
 	}
 
+	output_layout_index_build(layout);
+
 	wlr_signal_emit_safe(&layout->events.change, layout);
 }
 
@@ -174,6 +396,11 @@ static struct wlr_output_layout_output *output_layout_output_create(
 		free(l_output);
 		return NULL;
 	}
+	if (!hash_table_set(&layout->state->outputs, (uintptr_t)output, l_output)) {
+		free(l_output->state);
+		free(l_output);
+		return NULL;
+	}
 	l_output->state->l_output = l_output;
 	l_output->state->layout = layout;
 	l_output->output = output;
@@ -216,13 +443,7 @@ void wlr_output_layout_add(struct wlr_output_layout *layout,
 
 struct wlr_output_layout_output *wlr_output_layout_get(
 		struct wlr_output_layout *layout, struct wlr_output *reference) {
-	struct wlr_output_layout_output *l_output;
-	wl_list_for_each(l_output, &layout->outputs, link) {
-		if (l_output->output == reference) {
-			return l_output;
-		}
-	}
-	return NULL;
+	return hash_table_get(&layout->state->outputs, (uintptr_t)reference);
 }
 
 bool wlr_output_layout_contains_point(struct wlr_output_layout *layout,
@@ -242,6 +463,11 @@ bool wlr_output_layout_intersects(struct wlr_output_layout *layout,
 	struct wlr_box out_box;
 
 	if (reference == NULL) {
+		if (layout->state->index.valid) {
+			return output_layout_index_intersects(&layout->state->index,
+				target_lbox);
+		}
+
 		struct wlr_output_layout_output *l_output;
 		wl_list_for_each(l_output, &layout->outputs, link) {
 			struct wlr_box *output_box =
@@ -266,6 +492,11 @@ bool wlr_output_layout_intersects(struct wlr_output_layout *layout,
 struct wlr_output *wlr_output_layout_output_at(struct wlr_output_layout *layout,
 		double lx, double ly) {
 	struct wlr_output_layout_output *l_output;
+	if (layout->state->index.valid) {
+		l_output = output_layout_index_output_at(&layout->state->index, lx, ly);
+		return l_output != NULL ? l_output->output : NULL;
+	}
+
 	wl_list_for_each(l_output, &layout->outputs, link) {
 		struct wlr_box *box = output_layout_output_get_box(l_output);
 		if (wlr_box_contains_point(box, lx, ly)) {
@@ -302,16 +533,11 @@ void wlr_output_layout_remove(struct wlr_output_layout *layout,
 void wlr_output_layout_output_coords(struct wlr_output_layout *layout,
 		struct wlr_output *reference, double *lx, double *ly) {
 	assert(layout && reference);
-	double src_x = *lx;
-	double src_y = *ly;
-
-	struct wlr_output_layout_output *l_output;
-	wl_list_for_each(l_output, &layout->outputs, link) {
-		if (l_output->output == reference) {
-			*lx = src_x - (double)l_output->x;
-			*ly = src_y - (double)l_output->y;
-			return;
-		}
+	struct wlr_output_layout_output *l_output =
+		wlr_output_layout_get(layout, reference);
+	if (l_output != NULL) {
+		*lx -= (double)l_output->x;
+		*ly -= (double)l_output->y;
 	}
 }
 
@@ -323,6 +549,15 @@ void wlr_output_layout_closest_point(struct wlr_output_layout *layout,
 	}
 
 	double min_x = 0, min_y = 0, min_distance = DBL_MAX;
+	struct output_layout_index *index = &layout->state->index;
+	if (reference == NULL && index->valid &&
+			output_layout_index_output_at(index, lx, ly) != NULL) {
+		// The point is already inside the layout
+		min_x = lx;
+		min_y = ly;
+		goto out;
+	}
+
 	struct wlr_output_layout_output *l_output;
 	wl_list_for_each(l_output, &layout->outputs, link) {
 		if (reference != NULL && reference != l_output->output) {
@@ -348,6 +583,7 @@ void wlr_output_layout_closest_point(struct wlr_output_layout *layout,
 		}
 	}
 
+out:
 	if (dest_lx) {
 		*dest_lx = min_x;
 	}
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <drm_fourcc.h>
 #include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_buffer.h>
 #include <wlr/types/wlr_matrix.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_linux_dmabuf_v1.h>
@@ -13,18 +14,211 @@
 #include "util/signal.h"
 
 #define SCREENCOPY_MANAGER_VERSION 3
+// Number of imported output buffers kept per output, enough to cover a whole
+// swapchain
+#define SCREENCOPY_TEXTURE_CACHE_SIZE 4
+// Number of client shm buffers whose contents are tracked per output
+#define SCREENCOPY_BUFFER_CACHE_SIZE 4
 
 struct screencopy_damage {
 	struct wl_list link;
 	struct wlr_output *output;
 	struct pixman_region32 damage;
+	struct wl_list buffers; // screencopy_buffer.link
 	struct wl_listener output_precommit;
 	struct wl_listener output_destroy;
 	uint32_t last_commit_seq;
 };
 
+/**
+ * An output buffer imported as a texture, kept around so that DMA-BUF frames
+ * don't have to re-import the same swapchain buffers on every capture. The
+ * texture is dropped as soon as the buffer is destroyed, e.g. when the output
+ * swapchain is re-created.
+ */
+struct screencopy_texture {
+	struct wl_list link; // wlr_screencopy_manager_v1.textures
+	struct wlr_output *output;
+	struct wlr_renderer *renderer;
+	struct wlr_buffer *buffer;
+	struct wlr_texture *texture;
+	struct wl_listener output_destroy;
+	struct wl_listener buffer_destroy;
+};
+
+/**
+ * A client shm buffer which has been filled by a previous frame. As long as
+ * the client keeps re-using it for the same region, only the damage
+ * accumulated since it was last filled needs to be copied into it.
+ */
+struct screencopy_buffer {
+	struct wl_list link; // screencopy_damage.buffers
+	struct wl_resource *resource;
+	struct wlr_box box; // frame box the buffer was last filled for
+	struct pixman_region32 damage; // since the buffer was last filled
+	struct wl_listener resource_destroy;
+};
+
 static const struct zwlr_screencopy_frame_v1_interface frame_impl;
 
+static void screencopy_texture_destroy(struct screencopy_texture *tex) {
+	wl_list_remove(&tex->link);
+	wl_list_remove(&tex->output_destroy.link);
+	wl_list_remove(&tex->buffer_destroy.link);
+	wlr_texture_destroy(tex->texture);
+	free(tex);
+}
+
+static void screencopy_texture_handle_output_destroy(
+		struct wl_listener *listener, void *data) {
+	struct screencopy_texture *tex =
+		wl_container_of(listener, tex, output_destroy);
+	screencopy_texture_destroy(tex);
+}
+
+static void screencopy_texture_handle_buffer_destroy(
+		struct wl_listener *listener, void *data) {
+	struct screencopy_texture *tex =
+		wl_container_of(listener, tex, buffer_destroy);
+	screencopy_texture_destroy(tex);
+}
+
+static struct wlr_texture *screencopy_texture_get(
+		struct wlr_screencopy_manager_v1 *manager, struct wlr_output *output,
+		struct wlr_renderer *renderer, struct wlr_buffer *buffer) {
+	size_t output_textures_len = 0;
+	struct screencopy_texture *tex, *oldest = NULL;
+	wl_list_for_each(tex, &manager->textures, link) {
+		if (tex->output != output) {
+			continue;
+		}
+		if (tex->renderer == renderer && tex->buffer == buffer) {
+			// Keep the list sorted from most to least recently used
+			wl_list_remove(&tex->link);
+			wl_list_insert(&manager->textures, &tex->link);
+			return tex->texture;
+		}
+		output_textures_len++;
+		oldest = tex;
+	}
+
+	// Only DMA-BUFs are cached: the texture shares their memory, so it
+	// always reflects the buffer's current contents
+	struct wlr_dmabuf_attributes attrs;
+	if (!wlr_buffer_get_dmabuf(buffer, &attrs)) {
+		return NULL;
+	}
+
+	if (output_textures_len >= SCREENCOPY_TEXTURE_CACHE_SIZE) {
+		screencopy_texture_destroy(oldest);
+	}
+
+	tex = calloc(1, sizeof(*tex));
+	if (tex == NULL) {
+		return NULL;
+	}
+
+	tex->texture = wlr_texture_from_dmabuf(renderer, &attrs);
+	if (tex->texture == NULL) {
+		free(tex);
+		return NULL;
+	}
+
+	tex->output = output;
+	tex->renderer = renderer;
+	tex->buffer = buffer;
+
+	wl_list_insert(&manager->textures, &tex->link);
+
+	tex->output_destroy.notify = screencopy_texture_handle_output_destroy;
+	wl_signal_add(&output->events.destroy, &tex->output_destroy);
+
+	tex->buffer_destroy.notify = screencopy_texture_handle_buffer_destroy;
+	wl_signal_add(&buffer->events.destroy, &tex->buffer_destroy);
+
+	return tex->texture;
+}
+
+static void screencopy_buffer_destroy(struct screencopy_buffer *buffer) {
+	wl_list_remove(&buffer->link);
+	wl_list_remove(&buffer->resource_destroy.link);
+	pixman_region32_fini(&buffer->damage);
+	free(buffer);
+}
+
+static void screencopy_buffer_handle_resource_destroy(
+		struct wl_listener *listener, void *data) {
+	struct screencopy_buffer *buffer =
+		wl_container_of(listener, buffer, resource_destroy);
+	screencopy_buffer_destroy(buffer);
+}
+
+static struct screencopy_buffer *screencopy_buffer_find(
+		struct screencopy_damage *damage, struct wl_resource *resource) {
+	struct screencopy_buffer *buffer;
+	wl_list_for_each(buffer, &damage->buffers, link) {
+		if (buffer->resource == resource) {
+			return buffer;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Marks the buffer as filled for the given box. Returns false if the buffer
+ * couldn't be tracked, in which case it'll be filled entirely next time.
+ */
+static bool screencopy_buffer_reset(struct screencopy_damage *damage,
+		struct wl_resource *resource, const struct wlr_box *box) {
+	struct screencopy_buffer *buffer = screencopy_buffer_find(damage, resource);
+	if (buffer == NULL) {
+		if (wl_list_length(&damage->buffers) >= SCREENCOPY_BUFFER_CACHE_SIZE) {
+			struct screencopy_buffer *oldest =
+				wl_container_of(damage->buffers.prev, oldest, link);
+			screencopy_buffer_destroy(oldest);
+		}
+
+		buffer = calloc(1, sizeof(*buffer));
+		if (buffer == NULL) {
+			return false;
+		}
+		buffer->resource = resource;
+		pixman_region32_init(&buffer->damage);
+
+		buffer->resource_destroy.notify =
+			screencopy_buffer_handle_resource_destroy;
+		wl_resource_add_destroy_listener(resource, &buffer->resource_destroy);
+	} else {
+		wl_list_remove(&buffer->link);
+	}
+	wl_list_insert(&damage->buffers, &buffer->link);
+
+	buffer->box = *box;
+	pixman_region32_clear(&buffer->damage);
+	return true;
+}
+
+/**
+ * Stops tracking the contents of the buffer for every output of the client
+ * but the one of the except damage, which may be NULL. A shm buffer can be
+ * filled from any output: once it has been, what the other outputs know about
+ * its contents is stale.
+ */
+static void client_forget_buffer(struct wlr_screencopy_v1_client *client,
+		struct wl_resource *resource, struct screencopy_damage *except) {
+	struct screencopy_damage *damage;
+	wl_list_for_each(damage, &client->damages, link) {
+		if (damage == except) {
+			continue;
+		}
+		struct screencopy_buffer *buffer =
+			screencopy_buffer_find(damage, resource);
+		if (buffer != NULL) {
+			screencopy_buffer_destroy(buffer);
+		}
+	}
+}
+
 static struct screencopy_damage *screencopy_damage_find(
 		struct wlr_screencopy_v1_client *client,
 		struct wlr_output *output) {
@@ -50,18 +244,26 @@ static void screencopy_damage_accumulate(struct screencopy_damage *damage) {
 		return;
 	}
 
+	struct pixman_region32 new_damage;
+	pixman_region32_init(&new_damage);
 	if (output->pending.committed & WLR_OUTPUT_STATE_DAMAGE) {
 		// If the compositor submitted damage, copy it over
-		pixman_region32_union(region, region, &output->pending.damage);
-		pixman_region32_intersect_rect(region, region, 0, 0,
-			output->width, output->height);
+		pixman_region32_intersect_rect(&new_damage, &output->pending.damage,
+			0, 0, output->width, output->height);
 	} else if (output->pending.committed & WLR_OUTPUT_STATE_BUFFER) {
 		// If the compositor did not submit damage but did submit a buffer
 		// damage everything
-		pixman_region32_union_rect(region, region, 0, 0,
+		pixman_region32_union_rect(&new_damage, &new_damage, 0, 0,
 			output->width, output->height);
 	}
 
+	pixman_region32_union(region, region, &new_damage);
+	struct screencopy_buffer *buffer;
+	wl_list_for_each(buffer, &damage->buffers, link) {
+		pixman_region32_union(&buffer->damage, &buffer->damage, &new_damage);
+	}
+	pixman_region32_fini(&new_damage);
+
 	damage->last_commit_seq = output->commit_seq;
 }
 
@@ -73,6 +275,10 @@ static void screencopy_damage_handle_output_precommit(
 }
 
 static void screencopy_damage_destroy(struct screencopy_damage *damage) {
+	struct screencopy_buffer *buffer, *tmp_buffer;
+	wl_list_for_each_safe(buffer, tmp_buffer, &damage->buffers, link) {
+		screencopy_buffer_destroy(buffer);
+	}
 	wl_list_remove(&damage->output_destroy.link);
 	wl_list_remove(&damage->output_precommit.link);
 	wl_list_remove(&damage->link);
@@ -100,6 +306,7 @@ static struct screencopy_damage *screencopy_damage_create(
 	damage->last_commit_seq = output->commit_seq - 1;
 	pixman_region32_init_rect(&damage->damage, 0, 0, output->width,
 		output->height);
+	wl_list_init(&damage->buffers);
 	wl_list_insert(&client->damages, &damage->link);
 
 	wl_signal_add(&output->events.precommit, &damage->output_precommit);
@@ -141,17 +348,26 @@ static struct wlr_screencopy_frame_v1 *frame_from_resource(
 	return wl_resource_get_user_data(resource);
 }
 
-static void frame_destroy(struct wlr_screencopy_frame_v1 *frame) {
-	if (frame == NULL) {
-		return;
-	}
-	if (frame->output != NULL &&
+static void frame_unlock_output(struct wlr_screencopy_frame_v1 *frame) {
+	if (frame->output != NULL && !frame->output_unlocked &&
 			(frame->shm_buffer != NULL || frame->dma_buffer != NULL)) {
 		wlr_output_lock_attach_render(frame->output, false);
 		if (frame->cursor_locked) {
 			wlr_output_lock_software_cursors(frame->output, false);
 		}
 	}
+	frame->output_unlocked = true;
+}
+
+static void frame_destroy(struct wlr_screencopy_frame_v1 *frame) {
+	if (frame == NULL) {
+		return;
+	}
+	frame_unlock_output(frame);
+	if (frame->readback_source != NULL) {
+		wl_event_source_remove(frame->readback_source);
+	}
+	wlr_renderer_readback_destroy(frame->readback);
 	wl_list_remove(&frame->link);
 	wl_list_remove(&frame->output_precommit.link);
 	wl_list_remove(&frame->output_commit.link);
@@ -164,30 +380,40 @@ static void frame_destroy(struct wlr_screencopy_frame_v1 *frame) {
 	free(frame);
 }
 
-static void frame_send_damage(struct wlr_screencopy_frame_v1 *frame) {
+/**
+ * Gets the damage accumulated since the client's last frame and resets it.
+ */
+static bool frame_take_damage(struct wlr_screencopy_frame_v1 *frame,
+		struct wlr_box *box) {
 	if (!frame->with_damage) {
-		return;
+		return false;
 	}
 
 	struct screencopy_damage *damage =
 		screencopy_damage_get_or_create(frame->client, frame->output);
 	if (damage == NULL) {
-		return;
+		return false;
 	}
 
 	// TODO: send fine-grained damage events
 	struct pixman_box32 *damage_box =
 		pixman_region32_extents(&damage->damage);
 
-	int damage_x = damage_box->x1;
-	int damage_y = damage_box->y1;
-	int damage_width = damage_box->x2 - damage_box->x1;
-	int damage_height = damage_box->y2 - damage_box->y1;
-
-	zwlr_screencopy_frame_v1_send_damage(frame->resource,
-		damage_x, damage_y, damage_width, damage_height);
+	box->x = damage_box->x1;
+	box->y = damage_box->y1;
+	box->width = damage_box->x2 - damage_box->x1;
+	box->height = damage_box->y2 - damage_box->y1;
 
 	pixman_region32_clear(&damage->damage);
+	return true;
+}
+
+static void frame_send_damage(struct wlr_screencopy_frame_v1 *frame) {
+	struct wlr_box box;
+	if (frame_take_damage(frame, &box)) {
+		zwlr_screencopy_frame_v1_send_damage(frame->resource,
+			box.x, box.y, box.width, box.height);
+	}
 }
 
 static void frame_send_ready(struct wlr_screencopy_frame_v1 *frame,
@@ -199,6 +425,136 @@ static void frame_send_ready(struct wlr_screencopy_frame_v1 *frame,
 		tv_sec_hi, tv_sec_lo, when->tv_nsec);
 }
 
+/**
+ * Computes the region of the output buffer to copy into the client's shm
+ * buffer, in buffer coordinates. If the buffer already holds a previous frame
+ * of the same region, only the damage since then is copied. The buffer is
+ * then considered filled up to the current commit.
+ */
+static void frame_get_copy_region(struct wlr_screencopy_frame_v1 *frame,
+		struct pixman_region32 *region) {
+	struct wlr_box *box = &frame->box;
+	pixman_region32_init_rect(region, box->x, box->y,
+		box->width, box->height);
+
+	struct screencopy_damage *damage = NULL;
+	if (frame->with_damage) {
+		damage = screencopy_damage_find(frame->client, frame->output);
+	}
+	client_forget_buffer(frame->client, frame->buffer_resource, damage);
+	if (damage == NULL) {
+		return;
+	}
+
+	struct screencopy_buffer *buffer =
+		screencopy_buffer_find(damage, frame->buffer_resource);
+	if (buffer != NULL && buffer->box.x == box->x &&
+			buffer->box.y == box->y && buffer->box.width == box->width &&
+			buffer->box.height == box->height) {
+		pixman_region32_intersect(region, region, &buffer->damage);
+	}
+
+	screencopy_buffer_reset(damage, frame->buffer_resource, box);
+}
+
+/**
+ * Stops tracking the contents of the frame's buffer, e.g. because filling it
+ * failed.
+ */
+static void frame_forget_buffer(struct wlr_screencopy_frame_v1 *frame) {
+	client_forget_buffer(frame->client, frame->buffer_resource, NULL);
+}
+
+static void frame_finish_readback(struct wlr_screencopy_frame_v1 *frame) {
+	struct wl_shm_buffer *shm_buffer = frame->shm_buffer;
+	int32_t stride = wl_shm_buffer_get_stride(shm_buffer);
+
+	wl_shm_buffer_begin_access(shm_buffer);
+	void *data = wl_shm_buffer_get_data(shm_buffer);
+	uint32_t renderer_flags = 0;
+	bool ok = wlr_renderer_readback_finish(frame->readback, &renderer_flags,
+		stride, frame->readback_box.x, frame->readback_box.y, data);
+	uint32_t flags = renderer_flags & WLR_RENDERER_READ_PIXELS_Y_INVERT ?
+		ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT : 0;
+	wl_shm_buffer_end_access(shm_buffer);
+
+	if (!ok) {
+		wlr_log(WLR_ERROR, "Failed to read pixels from renderer");
+		frame_forget_buffer(frame);
+		zwlr_screencopy_frame_v1_send_failed(frame->resource);
+		frame_destroy(frame);
+		return;
+	}
+
+	zwlr_screencopy_frame_v1_send_flags(frame->resource, flags);
+	if (frame->readback_has_damage) {
+		struct wlr_box *box = &frame->readback_damage;
+		zwlr_screencopy_frame_v1_send_damage(frame->resource,
+			box->x, box->y, box->width, box->height);
+	}
+	frame_send_ready(frame, &frame->readback_when);
+	frame_destroy(frame);
+}
+
+static int frame_handle_readback_fence(int fd, uint32_t mask, void *data) {
+	struct wlr_screencopy_frame_v1 *frame = data;
+	frame_finish_readback(frame);
+	return 0;
+}
+
+static int frame_handle_readback_timer(void *data) {
+	struct wlr_screencopy_frame_v1 *frame = data;
+	// A whole refresh period went by since the read-back was started, so it
+	// has almost certainly completed and finishing it won't block
+	frame_finish_readback(frame);
+	return 0;
+}
+
+/**
+ * Completes the frame once the pixels copied by the GPU are available, in a
+ * later event loop iteration, instead of stalling the output commit. If the
+ * renderer provides a fence FD, the frame completes as soon as it signals.
+ * Otherwise, it completes once after a refresh period. This doesn't depend on
+ * the output producing another frame, which may never happen if the commit
+ * fails or the output is idle.
+ */
+static void frame_start_readback(struct wlr_screencopy_frame_v1 *frame,
+		struct wlr_renderer_readback *readback, struct timespec *when) {
+	frame->readback = readback;
+	frame->readback_when = *when;
+	frame->readback_has_damage =
+		frame_take_damage(frame, &frame->readback_damage);
+
+	// The output contents have been captured, don't hold up direct scan-out
+	// and hardware cursors any longer
+	frame_unlock_output(frame);
+
+	struct wl_client *client = wl_resource_get_client(frame->resource);
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(wl_client_get_display(client));
+
+	int fence_fd = wlr_renderer_readback_get_fence_fd(readback);
+	if (fence_fd >= 0) {
+		frame->readback_source = wl_event_loop_add_fd(loop, fence_fd,
+			WL_EVENT_READABLE, frame_handle_readback_fence, frame);
+		if (frame->readback_source != NULL) {
+			return;
+		}
+	}
+
+	frame->readback_source =
+		wl_event_loop_add_timer(loop, frame_handle_readback_timer, frame);
+	if (frame->readback_source == NULL) {
+		frame_finish_readback(frame);
+		return;
+	}
+	int refresh_ms = 16;
+	if (frame->output->refresh > 0) {
+		refresh_ms = 1000000 / frame->output->refresh + 1;
+	}
+	wl_event_source_timer_update(frame->readback_source, refresh_ms);
+}
+
 static void frame_handle_output_precommit(struct wl_listener *listener,
 		void *_data) {
 	struct wlr_screencopy_frame_v1 *frame =
@@ -236,21 +592,52 @@ static void frame_handle_output_precommit(struct wl_listener *listener,
 
 	enum wl_shm_format wl_shm_format = wl_shm_buffer_get_format(shm_buffer);
 	uint32_t drm_format = convert_wl_shm_format_to_drm(wl_shm_format);
-	int32_t width = wl_shm_buffer_get_width(shm_buffer);
-	int32_t height = wl_shm_buffer_get_height(shm_buffer);
 	int32_t stride = wl_shm_buffer_get_stride(shm_buffer);
 
+	struct pixman_region32 region;
+	frame_get_copy_region(frame, &region);
+
+	// The asynchronous path reads back a single rectangle, use the extents
+	// of the region
+	struct pixman_box32 *extents = pixman_region32_extents(&region);
+	if (pixman_region32_not_empty(&region)) {
+		struct wlr_renderer_readback *readback =
+			wlr_renderer_read_pixels_async(renderer, drm_format,
+			extents->x2 - extents->x1, extents->y2 - extents->y1,
+			extents->x1, extents->y1);
+		if (readback != NULL) {
+			frame->readback_box = (struct wlr_box){
+				.x = extents->x1 - x,
+				.y = extents->y1 - y,
+				.width = extents->x2 - extents->x1,
+				.height = extents->y2 - extents->y1,
+			};
+			pixman_region32_fini(&region);
+			frame_start_readback(frame, readback, event->when);
+			return;
+		}
+	}
+
 	wl_shm_buffer_begin_access(shm_buffer);
 	void *data = wl_shm_buffer_get_data(shm_buffer);
 	uint32_t renderer_flags = 0;
-	bool ok = wlr_renderer_read_pixels(renderer, drm_format, &renderer_flags,
-		stride, width, height, x, y, 0, 0, data);
+	bool ok = true;
+	int rects_len;
+	struct pixman_box32 *rects = pixman_region32_rectangles(&region, &rects_len);
+	for (int i = 0; i < rects_len && ok; i++) {
+		struct pixman_box32 *rect = &rects[i];
+		ok = wlr_renderer_read_pixels(renderer, drm_format, &renderer_flags,
+			stride, rect->x2 - rect->x1, rect->y2 - rect->y1,
+			rect->x1, rect->y1, rect->x1 - x, rect->y1 - y, data);
+	}
 	uint32_t flags = renderer_flags & WLR_RENDERER_READ_PIXELS_Y_INVERT ?
 		ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT : 0;
 	wl_shm_buffer_end_access(shm_buffer);
+	pixman_region32_fini(&region);
 
 	if (!ok) {
 		wlr_log(WLR_ERROR, "Failed to read pixels from renderer");
+		frame_forget_buffer(frame);
 		zwlr_screencopy_frame_v1_send_failed(frame->resource);
 		frame_destroy(frame);
 		return;
@@ -262,38 +649,39 @@ static void frame_handle_output_precommit(struct wl_listener *listener,
 	frame_destroy(frame);
 }
 
+/**
+ * Render the region of the source texture described by src_box (in buffer
+ * coordinates) onto the whole destination buffer, scaling it if the sizes
+ * differ.
+ */
 static bool blit_dmabuf(struct wlr_renderer *renderer,
 		struct wlr_dmabuf_v1_buffer *dst_dmabuf,
-		struct wlr_dmabuf_attributes *src_attrs) {
+		struct wlr_texture *src_tex, const struct wlr_box *src_box) {
 	struct wlr_buffer *dst_buffer = wlr_buffer_lock(&dst_dmabuf->base);
 
-	struct wlr_texture *src_tex = wlr_texture_from_dmabuf(renderer, src_attrs);
-	if (src_tex == NULL) {
-		goto error_src_tex;
-	}
+	struct wlr_fbox src_fbox = {
+		.x = src_box->x,
+		.y = src_box->y,
+		.width = src_box->width,
+		.height = src_box->height,
+	};
 
 	float mat[9];
 	wlr_matrix_identity(mat);
 	wlr_matrix_scale(mat, dst_buffer->width, dst_buffer->height);
 
 	if (!wlr_renderer_begin_with_buffer(renderer, dst_buffer)) {
-		goto error_renderer_begin;
+		wlr_buffer_unlock(dst_buffer);
+		return false;
 	}
 
 	wlr_renderer_clear(renderer, (float[]){ 0.0, 0.0, 0.0, 0.0 });
-	wlr_render_texture_with_matrix(renderer, src_tex, mat, 1.0f);
+	wlr_render_subtexture_with_matrix(renderer, src_tex, &src_fbox, mat, 1.0f);
 
 	wlr_renderer_end(renderer);
 
-	wlr_texture_destroy(src_tex);
 	wlr_buffer_unlock(dst_buffer);
 	return true;
-
-error_renderer_begin:
-	wlr_texture_destroy(src_tex);
-error_src_tex:
-	wlr_buffer_unlock(dst_buffer);
-	return false;
 }
 
 static void frame_handle_output_commit(struct wl_listener *listener,
@@ -325,21 +713,15 @@ static void frame_handle_output_commit(struct wl_listener *listener,
 	wl_list_remove(&frame->output_commit.link);
 	wl_list_init(&frame->output_commit.link);
 
-	// TODO: add support for copying regions with DMA-BUFs
-	if (frame->box.x != 0 || frame->box.y != 0 ||
-			output->width != frame->box.width ||
-			output->height != frame->box.height) {
-		zwlr_screencopy_frame_v1_send_failed(frame->resource);
-		frame_destroy(frame);
-		return;
+	struct wlr_texture *src_tex = NULL;
+	if (event->buffer != NULL) {
+		src_tex = screencopy_texture_get(frame->client->manager, output,
+			renderer, event->buffer);
 	}
-
-	struct wlr_dmabuf_attributes attr = { 0 };
-	bool ok = wlr_output_export_dmabuf(output, &attr);
-	ok = ok && blit_dmabuf(renderer, dma_buffer, &attr);
+	bool ok = src_tex != NULL && blit_dmabuf(renderer, dma_buffer, src_tex,
+		&frame->box);
 	uint32_t flags = dma_buffer->attributes.flags & WLR_DMABUF_ATTRIBUTES_FLAGS_Y_INVERT ?
 		ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT : 0;
-	wlr_dmabuf_attributes_finish(&attr);
 
 	if (!ok) {
 		zwlr_screencopy_frame_v1_send_failed(frame->resource);
@@ -467,6 +849,7 @@ static void frame_handle_copy(struct wl_client *wl_client,
 
 	frame->shm_buffer = shm_buffer;
 	frame->dma_buffer = dma_buffer;
+	frame->buffer_resource = buffer_resource;
 
 	wl_signal_add(&output->events.precommit, &frame->output_precommit);
 	frame->output_precommit.notify = frame_handle_output_precommit;
@@ -719,6 +1102,10 @@ static void handle_display_destroy(struct wl_listener *listener, void *data) {
 	struct wlr_screencopy_manager_v1 *manager =
 		wl_container_of(listener, manager, display_destroy);
 	wlr_signal_emit_safe(&manager->events.destroy, manager);
+	struct screencopy_texture *tex, *tmp;
+	wl_list_for_each_safe(tex, tmp, &manager->textures, link) {
+		screencopy_texture_destroy(tex);
+	}
 	wl_list_remove(&manager->display_destroy.link);
 	wl_global_destroy(manager->global);
 	free(manager);
@@ -740,6 +1127,7 @@ struct wlr_screencopy_manager_v1 *wlr_screencopy_manager_v1_create(
 		return NULL;
 	}
 	wl_list_init(&manager->frames);
+	wl_list_init(&manager->textures);
 
 	wl_signal_init(&manager->events.destroy);
 
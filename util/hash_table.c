@@ -0,0 +1,131 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <wlr/util/log.h>
+#include "util/hash_table.h"
+
+#define MIN_CAP 16
+
+static uint64_t hash_key(uint64_t key) {
+	// Finalizer of MurmurHash3, spreads sequential keys over the whole table
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+void hash_table_init(struct hash_table *table) {
+	table->entries = NULL;
+	table->len = 0;
+	table->cap = 0;
+}
+
+void hash_table_finish(struct hash_table *table) {
+	free(table->entries);
+	hash_table_init(table);
+}
+
+static struct hash_table_entry *find_slot(struct hash_table_entry *entries,
+		size_t cap, uint64_t key) {
+	size_t mask = cap - 1;
+	size_t i = hash_key(key) & mask;
+	while (entries[i].value != NULL && entries[i].key != key) {
+		i = (i + 1) & mask;
+	}
+	return &entries[i];
+}
+
+void *hash_table_get(const struct hash_table *table, uint64_t key) {
+	if (table->len == 0) {
+		return NULL;
+	}
+	return find_slot(table->entries, table->cap, key)->value;
+}
+
+static bool resize(struct hash_table *table, size_t cap) {
+	struct hash_table_entry *entries = calloc(cap, sizeof(*entries));
+	if (entries == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+
+	for (size_t i = 0; i < table->cap; i++) {
+		struct hash_table_entry *entry = &table->entries[i];
+		if (entry->value != NULL) {
+			*find_slot(entries, cap, entry->key) = *entry;
+		}
+	}
+
+	free(table->entries);
+	table->entries = entries;
+	table->cap = cap;
+	return true;
+}
+
+bool hash_table_set(struct hash_table *table, uint64_t key, void *value) {
+	assert(value != NULL);
+
+	// Keep the load factor under 1/2 so that probe sequences stay short
+	if ((table->len + 1) * 2 > table->cap) {
+		size_t cap = table->cap > 0 ? table->cap * 2 : MIN_CAP;
+		if (!resize(table, cap)) {
+			return false;
+		}
+	}
+
+	struct hash_table_entry *entry = find_slot(table->entries, table->cap, key);
+	if (entry->value == NULL) {
+		entry->key = key;
+		table->len++;
+	}
+	entry->value = value;
+	return true;
+}
+
+void *hash_table_remove(struct hash_table *table, uint64_t key) {
+	if (table->len == 0) {
+		return NULL;
+	}
+
+	struct hash_table_entry *entry = find_slot(table->entries, table->cap, key);
+	void *value = entry->value;
+	if (value == NULL) {
+		return NULL;
+	}
+
+	// Shift back the following entries of the probe sequence, so that
+	// lookups don't stop early at the slot we're freeing
+	size_t mask = table->cap - 1;
+	size_t i = entry - table->entries;
+	size_t j = i;
+	while (true) {
+		j = (j + 1) & mask;
+		if (table->entries[j].value == NULL) {
+			break;
+		}
+		size_t home = hash_key(table->entries[j].key) & mask;
+		// Move the entry if its home slot isn't cyclically in (i, j]
+		bool in_range = i <= j ? (i < home && home <= j) :
+			(i < home || home <= j);
+		if (!in_range) {
+			table->entries[i] = table->entries[j];
+			i = j;
+		}
+	}
+	table->entries[i].key = 0;
+	table->entries[i].value = NULL;
+	table->len--;
+
+	return value;
+}
+
+void hash_table_for_each(const struct hash_table *table,
+		void (*iterator)(uint64_t key, void *value, void *data), void *data) {
+	for (size_t i = 0; i < table->cap; i++) {
+		struct hash_table_entry *entry = &table->entries[i];
+		if (entry->value != NULL) {
+			iterator(entry->key, entry->value, data);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#include <wlr/util/log.h>
+
+#include "util/rate_counter.h"
+
+#define RATE_COUNTER_PERIOD_MS 1000
+
+void rate_counter_init(struct rate_counter *counter,
+		struct wl_event_loop *loop, const char *name) {
+	*counter = (struct rate_counter){
+		.name = name,
+		.loop = loop,
+	};
+}
+
+void rate_counter_finish(struct rate_counter *counter) {
+	if (counter->timer != NULL) {
+		wl_event_source_remove(counter->timer);
+	}
+}
+
+static int handle_timer(void *data) {
+	struct rate_counter *counter = data;
+
+	counter->last_period = counter->period;
+	if (counter->period == 0) {
+		// Wait for the next occurrence to start a new period
+		counter->running = false;
+		return 0;
+	}
+
+	wlr_log(WLR_DEBUG, "%zu %s within one second (%zu total)",
+		counter->period, counter->name, counter->total);
+	counter->period = 0;
+	// Run one more period, so that last_period drops back to zero if the
+	// event stops
+	wl_event_source_timer_update(counter->timer, RATE_COUNTER_PERIOD_MS);
+	return 0;
+}
+
+void rate_counter_add(struct rate_counter *counter) {
+	counter->total++;
+	counter->period++;
+
+	if (counter->running) {
+		return;
+	}
+	if (counter->timer == NULL) {
+		counter->timer =
+			wl_event_loop_add_timer(counter->loop, handle_timer, counter);
+		if (counter->timer == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create rate counter timer");
+			return;
+		}
+	}
+	wl_event_source_timer_update(counter->timer, RATE_COUNTER_PERIOD_MS);
+	counter->running = true;
+}
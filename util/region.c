@@ -1,7 +1,9 @@
 #include <assert.h>
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wlr/types/wlr_box.h>
 #include <wlr/util/region.h>
 
@@ -137,6 +139,202 @@ void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 	free(dst_rects);
 }
 
+static int64_t box_area(const pixman_box32_t *box) {
+	return (int64_t)(box->x2 - box->x1) * (box->y2 - box->y1);
+}
+
+static void box_union(pixman_box32_t *dst, const pixman_box32_t *a,
+		const pixman_box32_t *b) {
+	dst->x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+	dst->y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+	dst->x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+	dst->y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+}
+
+struct box_merge {
+	int64_t cost; // number of pixels added by the merge
+	int left, right;
+	uint32_t left_version, right_version;
+};
+
+static struct box_merge box_merge_init(const pixman_box32_t *boxes,
+		const uint32_t *versions, int left, int right) {
+	pixman_box32_t merged;
+	box_union(&merged, &boxes[left], &boxes[right]);
+	return (struct box_merge){
+		.cost = box_area(&merged) - box_area(&boxes[left]) -
+			box_area(&boxes[right]),
+		.left = left,
+		.right = right,
+		.left_version = versions[left],
+		.right_version = versions[right],
+	};
+}
+
+static bool box_merge_less(const struct box_merge *a,
+		const struct box_merge *b) {
+	if (a->cost != b->cost) {
+		return a->cost < b->cost;
+	}
+	return a->left < b->left;
+}
+
+static void merge_heap_push(struct box_merge *heap, size_t *len,
+		struct box_merge merge) {
+	size_t i = (*len)++;
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!box_merge_less(&merge, &heap[parent])) {
+			break;
+		}
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = merge;
+}
+
+static struct box_merge merge_heap_pop(struct box_merge *heap, size_t *len) {
+	struct box_merge top = heap[0];
+	struct box_merge last = heap[--(*len)];
+	size_t i = 0;
+	while (true) {
+		size_t child = 2 * i + 1;
+		if (child >= *len) {
+			break;
+		}
+		if (child + 1 < *len && box_merge_less(&heap[child + 1], &heap[child])) {
+			child++;
+		}
+		if (!box_merge_less(&heap[child], &last)) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = last;
+	return top;
+}
+
+/**
+ * Greedily merges the pair of neighbouring boxes which adds the fewest pixels,
+ * until at most max_boxes boxes are left. Candidate pairs are kept in a heap,
+ * pairs made stale by a merge are skipped when popped. Returns the new number
+ * of boxes, or -1 on allocation failure.
+ */
+static int merge_boxes(pixman_box32_t *boxes, int nboxes, int max_boxes) {
+	// The initial pairs, plus at most two new pairs per merge
+	struct box_merge *heap = malloc(3 * (size_t)nboxes * sizeof(*heap));
+	int *prev = malloc(nboxes * sizeof(*prev));
+	int *next = malloc(nboxes * sizeof(*next));
+	// Bumped whenever a box is grown or merged into its neighbour
+	uint32_t *versions = calloc(nboxes, sizeof(*versions));
+	if (heap == NULL || prev == NULL || next == NULL || versions == NULL) {
+		nboxes = -1;
+		goto out;
+	}
+
+	size_t heap_len = 0;
+	for (int i = 0; i < nboxes; ++i) {
+		prev[i] = i - 1;
+		next[i] = i + 1 < nboxes ? i + 1 : -1;
+		if (i + 1 < nboxes) {
+			merge_heap_push(heap, &heap_len,
+				box_merge_init(boxes, versions, i, i + 1));
+		}
+	}
+
+	int len = nboxes;
+	while (len > max_boxes && heap_len > 0) {
+		struct box_merge merge = merge_heap_pop(heap, &heap_len);
+		int left = merge.left, right = merge.right;
+		if (merge.left_version != versions[left] ||
+				merge.right_version != versions[right]) {
+			continue;
+		}
+
+		box_union(&boxes[left], &boxes[left], &boxes[right]);
+		versions[left]++;
+		versions[right]++;
+		next[left] = next[right];
+		if (next[left] >= 0) {
+			prev[next[left]] = left;
+		}
+		len--;
+
+		if (prev[left] >= 0) {
+			merge_heap_push(heap, &heap_len,
+				box_merge_init(boxes, versions, prev[left], left));
+		}
+		if (next[left] >= 0) {
+			merge_heap_push(heap, &heap_len,
+				box_merge_init(boxes, versions, left, next[left]));
+		}
+	}
+
+	// The first box is never merged into another one, walk the list from it
+	int n = 0;
+	for (int i = 0; i >= 0; i = next[i]) {
+		boxes[n++] = boxes[i];
+	}
+	nboxes = n;
+
+out:
+	free(heap);
+	free(prev);
+	free(next);
+	free(versions);
+	return nboxes;
+}
+
+void wlr_region_simplify(pixman_region32_t *dst, pixman_region32_t *src,
+		int max_rects) {
+	assert(max_rects > 0);
+
+	int nrects;
+	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
+	if (nrects <= max_rects) {
+		pixman_region32_copy(dst, src);
+		return;
+	}
+
+	pixman_box32_t *boxes = malloc(nrects * sizeof(pixman_box32_t));
+	if (boxes == NULL) {
+		pixman_region32_fini(dst);
+		pixman_region32_init_rect(dst, src->extents.x1, src->extents.y1,
+			src->extents.x2 - src->extents.x1,
+			src->extents.y2 - src->extents.y1);
+		return;
+	}
+
+	// Pixman regions are made of y-sorted bands of x-sorted rectangles.
+	// Collapse each band into a single box first: bands never overlap, so
+	// the boxes stay sorted and disjoint.
+	int nboxes = 0;
+	for (int i = 0; i < nrects; ++i) {
+		pixman_box32_t *last = nboxes > 0 ? &boxes[nboxes - 1] : NULL;
+		if (last != NULL && last->y1 == src_rects[i].y1 &&
+				last->y2 == src_rects[i].y2) {
+			last->x2 = src_rects[i].x2;
+		} else {
+			boxes[nboxes++] = src_rects[i];
+		}
+	}
+
+	nboxes = merge_boxes(boxes, nboxes, max_rects);
+	if (nboxes < 0) {
+		free(boxes);
+		pixman_region32_fini(dst);
+		pixman_region32_init_rect(dst, src->extents.x1, src->extents.y1,
+			src->extents.x2 - src->extents.x1,
+			src->extents.y2 - src->extents.y1);
+		return;
+	}
+
+	pixman_region32_fini(dst);
+	pixman_region32_init_rects(dst, boxes, nboxes);
+	free(boxes);
+}
+
 void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
 		float rotation, int ox, int oy) {
 	if (rotation == 0) {
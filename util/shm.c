@@ -3,6 +3,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 #include <wlr/config.h>
@@ -36,20 +37,68 @@ int create_shm_file(void) {
 	return -1;
 }
 
+static int truncate_shm_file(int fd, size_t size) {
+	int ret;
+	do {
+		ret = ftruncate(fd, size);
+	} while (ret < 0 && errno == EINTR);
+	return ret;
+}
+
 int allocate_shm_file(size_t size) {
 	int fd = create_shm_file();
 	if (fd < 0) {
 		return -1;
 	}
 
-	int ret;
-	do {
-		ret = ftruncate(fd, size);
-	} while (ret < 0 && errno == EINTR);
-	if (ret < 0) {
+	if (truncate_shm_file(fd, size) < 0) {
 		close(fd);
 		return -1;
 	}
 
 	return fd;
 }
+
+bool allocate_shm_file_pair(size_t size, int *rw_fd_ptr, int *ro_fd_ptr) {
+	int retries = 100;
+	int rw_fd = -1, ro_fd = -1;
+	do {
+		char name[] = "/wlroots-XXXXXX";
+		randname(name + strlen(name) - 6);
+
+		--retries;
+		// CLOEXEC is guaranteed to be set by shm_open
+		rw_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (rw_fd >= 0) {
+			ro_fd = shm_open(name, O_RDONLY, 0);
+			shm_unlink(name);
+			break;
+		}
+	} while (retries > 0 && errno == EEXIST);
+
+	if (rw_fd < 0) {
+		return false;
+	}
+	if (ro_fd < 0) {
+		close(rw_fd);
+		return false;
+	}
+
+	// Make sure the file cannot be re-opened in read-write mode (e.g. via
+	// "/proc/self/fd/" on Linux)
+	if (fchmod(rw_fd, 0) != 0) {
+		close(rw_fd);
+		close(ro_fd);
+		return false;
+	}
+
+	if (truncate_shm_file(rw_fd, size) < 0) {
+		close(rw_fd);
+		close(ro_fd);
+		return false;
+	}
+
+	*rw_fd_ptr = rw_fd;
+	*ro_fd_ptr = ro_fd;
+	return true;
+}
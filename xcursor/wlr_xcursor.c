@@ -25,13 +25,132 @@
 
 #define _POSIX_C_SOURCE 200809L
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wlr/util/log.h>
 #include <wlr/xcursor.h>
+#include "util/hash_table.h"
 #include "xcursor/xcursor.h"
 
+/**
+ * Entries with the same name hash are chained. Several entries may have the
+ * same name when inherited themes provide it too: they are chained in
+ * precedence order, so that a cursor which fails to load can be looked up in
+ * the next theme, like the eager loader does.
+ */
+struct wlr_xcursor_theme_entry {
+	char *name;
+	char *path; // cursor file, NULL once loaded or if not backed by a file
+	struct wlr_xcursor *cursor; // NULL if not loaded (yet)
+	struct wlr_xcursor_theme_entry *next; // next entry with the same hash
+};
+
+struct wlr_xcursor_theme_index {
+	struct hash_table entries; // name hash -> wlr_xcursor_theme_entry
+	size_t len; // number of distinct names
+};
+
+static uint64_t hash_name(const char *name) {
+	// 64-bit FNV-1a
+	uint64_t hash = 0xcbf29ce484222325;
+	for (const char *c = name; *c != '\0'; c++) {
+		hash ^= (uint8_t)*c;
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+/**
+ * Returns the first entry named name in the chain starting at entry.
+ */
+static struct wlr_xcursor_theme_entry *entry_find(
+		struct wlr_xcursor_theme_entry *entry, const char *name) {
+	while (entry != NULL && strcmp(entry->name, name) != 0) {
+		entry = entry->next;
+	}
+	return entry;
+}
+
+static struct wlr_xcursor_theme_entry *index_find(
+		struct wlr_xcursor_theme_index *index, const char *name) {
+	return entry_find(hash_table_get(&index->entries, hash_name(name)), name);
+}
+
+static struct wlr_xcursor_theme_entry *index_add(
+		struct wlr_xcursor_theme_index *index, const char *name,
+		const char *path) {
+	struct wlr_xcursor_theme_entry *entry = calloc(1, sizeof(*entry));
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	entry->name = strdup(name);
+	if (entry->name == NULL) {
+		goto error_entry;
+	}
+	if (path != NULL) {
+		entry->path = strdup(path);
+		if (entry->path == NULL) {
+			goto error_name;
+		}
+	}
+
+	// Append the entry, so that it comes after entries with the same name
+	// which take precedence
+	uint64_t key = hash_name(name);
+	struct wlr_xcursor_theme_entry *head = hash_table_get(&index->entries, key);
+	if (head == NULL) {
+		if (!hash_table_set(&index->entries, key, entry)) {
+			goto error_path;
+		}
+		index->len++;
+		return entry;
+	}
+
+	bool shadowed = false;
+	struct wlr_xcursor_theme_entry *tail = head;
+	while (true) {
+		shadowed = shadowed || strcmp(tail->name, name) == 0;
+		if (tail->next == NULL) {
+			break;
+		}
+		tail = tail->next;
+	}
+	tail->next = entry;
+	if (!shadowed) {
+		index->len++;
+	}
+	return entry;
+
+error_path:
+	free(entry->path);
+error_name:
+	free(entry->name);
+error_entry:
+	free(entry);
+	return NULL;
+}
+
+static void destroy_entries(uint64_t key, void *value, void *data) {
+	struct wlr_xcursor_theme_entry *entry = value;
+	while (entry != NULL) {
+		struct wlr_xcursor_theme_entry *next = entry->next;
+		// Cursors are owned by wlr_xcursor_theme.cursors
+		free(entry->name);
+		free(entry->path);
+		free(entry);
+		entry = next;
+	}
+}
+
+static void index_destroy(struct wlr_xcursor_theme_index *index) {
+	hash_table_for_each(&index->entries, destroy_entries, NULL);
+	hash_table_finish(&index->entries);
+	free(index);
+}
+
 static void xcursor_destroy(struct wlr_xcursor *cursor) {
 	for (size_t i = 0; i < cursor->image_count; i++) {
 		free(cursor->images[i]->buffer);
@@ -101,29 +220,42 @@ err_free_cursor:
 	return NULL;
 }
 
-static void load_default_theme(struct wlr_xcursor_theme *theme) {
-	uint32_t i;
+static bool theme_add_cursor(struct wlr_xcursor_theme *theme,
+		struct wlr_xcursor *cursor) {
+	struct wlr_xcursor **cursors = realloc(theme->cursors,
+		(theme->cursor_count + 1) * sizeof(theme->cursors[0]));
+	if (cursors == NULL) {
+		return false;
+	}
+	theme->cursors = cursors;
+	theme->cursors[theme->cursor_count++] = cursor;
+	return true;
+}
 
+static void load_default_theme(struct wlr_xcursor_theme *theme) {
 	free(theme->name);
 	theme->name = strdup("default");
 
-	theme->cursor_count = sizeof(cursor_metadata) / sizeof(cursor_metadata[0]);
-	theme->cursors = malloc(theme->cursor_count * sizeof(*theme->cursors));
-
-	if (theme->cursors == NULL) {
-		theme->cursor_count = 0;
-		return;
-	}
+	size_t n = sizeof(cursor_metadata) / sizeof(cursor_metadata[0]);
+	for (size_t i = 0; i < n; ++i) {
+		if (index_find(theme->index, cursor_metadata[i].name) != NULL) {
+			continue;
+		}
 
-	for (i = 0; i < theme->cursor_count; ++i) {
-		theme->cursors[i] =
+		struct wlr_xcursor *cursor =
 			xcursor_create_from_data(&cursor_metadata[i], theme);
+		if (cursor == NULL) {
+			break;
+		}
 
-		if (theme->cursors[i] == NULL) {
+		struct wlr_xcursor_theme_entry *entry =
+			index_add(theme->index, cursor->name, NULL);
+		if (entry == NULL || !theme_add_cursor(theme, cursor)) {
+			xcursor_destroy(cursor);
 			break;
 		}
+		entry->cursor = cursor;
 	}
-	theme->cursor_count = i;
 }
 
 static struct wlr_xcursor *xcursor_create_from_xcursor_images(
@@ -188,7 +320,7 @@ static void load_callback(XcursorImages *images, void *data) {
 	struct wlr_xcursor_theme *theme = data;
 	struct wlr_xcursor *cursor;
 
-	if (wlr_xcursor_theme_get_cursor(theme, images->name)) {
+	if (index_find(theme->index, images->name)) {
 		XcursorImagesDestroy(images);
 		return;
 	}
@@ -196,43 +328,63 @@ static void load_callback(XcursorImages *images, void *data) {
 	cursor = xcursor_create_from_xcursor_images(images, theme);
 
 	if (cursor) {
-		struct wlr_xcursor **cursors;
-		theme->cursor_count++;
-		cursors =
-			realloc(theme->cursors,
-				theme->cursor_count * sizeof(theme->cursors[0]));
-
-		if (cursors == NULL) {
-			theme->cursor_count--;
-			free(cursor);
+		struct wlr_xcursor_theme_entry *entry =
+			index_add(theme->index, cursor->name, NULL);
+		if (entry == NULL || !theme_add_cursor(theme, cursor)) {
+			xcursor_destroy(cursor);
 		} else {
-			theme->cursors = cursors;
-			theme->cursors[theme->cursor_count - 1] = cursor;
+			entry->cursor = cursor;
 		}
 	}
 
 	XcursorImagesDestroy(images);
 }
 
-struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
+static void index_callback(const char *name, const char *path, void *data) {
+	struct wlr_xcursor_theme *theme = data;
+	// Entries shadowed by an earlier one are kept as fallbacks
+	index_add(theme->index, name, path);
+}
+
+static struct wlr_xcursor_theme *theme_create(const char *name, int size) {
 	struct wlr_xcursor_theme *theme;
 
-	theme = malloc(sizeof(*theme));
+	theme = calloc(1, sizeof(*theme));
 	if (!theme) {
 		return NULL;
 	}
 
-	if (!name) {
-		name = "default";
-	}
-
 	theme->name = strdup(name);
 	if (!theme->name) {
 		goto out_error_name;
 	}
+	theme->index = calloc(1, sizeof(*theme->index));
+	if (!theme->index) {
+		goto out_error_index;
+	}
+	hash_table_init(&theme->index->entries);
 	theme->size = size;
-	theme->cursor_count = 0;
-	theme->cursors = NULL;
+
+	return theme;
+
+out_error_index:
+	free(theme->name);
+out_error_name:
+	free(theme);
+	return NULL;
+}
+
+struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
+	struct wlr_xcursor_theme *theme;
+
+	if (!name) {
+		name = "default";
+	}
+
+	theme = theme_create(name, size);
+	if (!theme) {
+		return NULL;
+	}
 
 	xcursor_load_theme(name, size, load_callback, theme);
 
@@ -244,10 +396,31 @@ struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
 			theme->name, size, theme->cursor_count);
 
 	return theme;
+}
 
-out_error_name:
-	free(theme);
-	return NULL;
+struct wlr_xcursor_theme *wlr_xcursor_theme_load_lazy(const char *name,
+		int size) {
+	struct wlr_xcursor_theme *theme;
+
+	if (!name) {
+		name = "default";
+	}
+
+	theme = theme_create(name, size);
+	if (!theme) {
+		return NULL;
+	}
+
+	xcursor_index_theme(name, index_callback, theme);
+
+	if (theme->index->len == 0) {
+		load_default_theme(theme);
+	}
+
+	wlr_log(WLR_DEBUG, "Indexed cursor theme '%s' at size %d (%zu available cursors)",
+			theme->name, size, theme->index->len);
+
+	return theme;
 }
 
 void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme) {
@@ -257,21 +430,54 @@ void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme) {
 		xcursor_destroy(theme->cursors[i]);
 	}
 
+	index_destroy(theme->index);
 	free(theme->name);
 	free(theme->cursors);
 	free(theme);
 }
 
+static void theme_load_entry(struct wlr_xcursor_theme *theme,
+		struct wlr_xcursor_theme_entry *entry) {
+	XcursorImages *images =
+		xcursor_load_file(entry->path, entry->name, theme->size);
+	if (images == NULL) {
+		wlr_log(WLR_ERROR, "Failed to load cursor '%s' from '%s'",
+			entry->name, entry->path);
+		goto out;
+	}
+
+	struct wlr_xcursor *cursor =
+		xcursor_create_from_xcursor_images(images, theme);
+	XcursorImagesDestroy(images);
+	if (cursor == NULL) {
+		goto out;
+	}
+
+	if (!theme_add_cursor(theme, cursor)) {
+		xcursor_destroy(cursor);
+		goto out;
+	}
+	entry->cursor = cursor;
+
+out:
+	// Don't try again: a missing cursor stays missing
+	free(entry->path);
+	entry->path = NULL;
+}
+
 struct wlr_xcursor *wlr_xcursor_theme_get_cursor(struct wlr_xcursor_theme *theme,
 		const char *name) {
-	unsigned int i;
-
-	for (i = 0; i < theme->cursor_count; i++) {
-		if (strcmp(name, theme->cursors[i]->name) == 0) {
-			return theme->cursors[i];
+	struct wlr_xcursor_theme_entry *entry = index_find(theme->index, name);
+	while (entry != NULL) {
+		if (entry->cursor == NULL && entry->path != NULL) {
+			theme_load_entry(theme, entry);
+		}
+		if (entry->cursor != NULL) {
+			return entry->cursor;
 		}
+		// Fall back to the same cursor in the next theme
+		entry = entry_find(entry->next, name);
 	}
-
 	return NULL;
 }
 
@@ -919,6 +919,38 @@ load_all_cursors_from_dir(const char *path, int size,
 	closedir(dir);
 }
 
+static void
+index_all_cursors_from_dir(const char *path,
+			   void (*index_callback)(const char *, const char *, void *),
+			   void *user_data)
+{
+	DIR *dir = opendir(path);
+	struct dirent *ent;
+	char *full;
+
+	if (!dir)
+		return;
+
+	for (ent = readdir(dir); ent; ent = readdir(dir)) {
+#ifdef _DIRENT_HAVE_D_TYPE
+		if (ent->d_type != DT_UNKNOWN &&
+		    (ent->d_type != DT_REG && ent->d_type != DT_LNK))
+			continue;
+#endif
+		if (ent->d_name[0] == '.')
+			continue;
+
+		full = _XcursorBuildFullname(path, "", ent->d_name);
+		if (!full)
+			continue;
+
+		index_callback(ent->d_name, full, user_data);
+		free(full);
+	}
+
+	closedir(dir);
+}
+
 /** Load all the cursor of a theme
  *
  * This function loads all the cursor images of a given theme and its
@@ -982,3 +1014,84 @@ xcursor_load_theme(const char *theme, int size,
 	if (inherits)
 		free(inherits);
 }
+
+/** Index the cursors of a theme without loading them
+ *
+ * This function walks the same directories as xcursor_load_theme(), in the
+ * same order, but doesn't open any cursor file. Instead, the index callback
+ * is called with the name of each cursor and the path of the file it can be
+ * loaded from with xcursor_load_file(). As with xcursor_load_theme(), a name
+ * may be reported more than once; the first occurrence takes precedence.
+ *
+ * \param theme The name of theme that should be indexed
+ * \param index_callback A callback function that will be called for each
+ * cursor file found. The strings are only valid for the duration of the call.
+ * \param user_data The data that should be passed to the index callback
+ */
+void
+xcursor_index_theme(const char *theme,
+		    void (*index_callback)(const char *, const char *, void *),
+		    void *user_data)
+{
+	char *full, *dir;
+	char *inherits = NULL;
+	const char *path, *i;
+
+	if (!theme)
+		theme = "default";
+
+	for (path = XcursorLibraryPath();
+	     path;
+	     path = _XcursorNextPath(path)) {
+		dir = _XcursorBuildThemeDir(path, theme);
+		if (!dir)
+			continue;
+
+		full = _XcursorBuildFullname(dir, "cursors", "");
+
+		if (full) {
+			index_all_cursors_from_dir(full, index_callback,
+						   user_data);
+			free(full);
+		}
+
+		if (!inherits) {
+			full = _XcursorBuildFullname(dir, "", "index.theme");
+			if (full) {
+				inherits = _XcursorThemeInherits(full);
+				free(full);
+			}
+		}
+
+		free(dir);
+	}
+
+	for (i = inherits; i; i = _XcursorNextPath(i))
+		xcursor_index_theme(i, index_callback, user_data);
+
+	if (inherits)
+		free(inherits);
+}
+
+/** Load the images of a single cursor file
+ *
+ * Only the images whose nominal size best matches the requested size are
+ * decoded. The returned object must be destroyed with XcursorImagesDestroy().
+ */
+XcursorImages *
+xcursor_load_file(const char *path, const char *name, int size)
+{
+	FILE *f;
+	XcursorImages *images;
+
+	f = fopen(path, "r");
+	if (!f)
+		return NULL;
+
+	images = XcursorFileLoadImages(f, size);
+	if (images)
+		XcursorImagesSetName(images, name);
+
+	fclose(f);
+	return images;
+}
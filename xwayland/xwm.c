@@ -100,16 +100,9 @@ struct wlr_xwayland_surface *wlr_xwayland_surface_from_wlr_surface(
 	return (struct wlr_xwayland_surface *)surface->role_data;
 }
 
-// TODO: replace this with hash table?
 static struct wlr_xwayland_surface *lookup_surface(struct wlr_xwm *xwm,
 		xcb_window_t window_id) {
-	struct wlr_xwayland_surface *surface;
-	wl_list_for_each(surface, &xwm->surfaces, link) {
-		if (surface->window_id == window_id) {
-			return surface;
-		}
-	}
-	return NULL;
+	return hash_table_get(&xwm->surfaces_by_id, window_id);
 }
 
 static int xwayland_surface_handle_ping_timeout(void *data) {
@@ -189,6 +182,12 @@ static struct wlr_xwayland_surface *xwayland_surface_create(
 		return NULL;
 	}
 
+	if (!hash_table_set(&xwm->surfaces_by_id, window_id, surface)) {
+		wl_event_source_remove(surface->ping_timer);
+		free(surface);
+		return NULL;
+	}
+
 	wl_list_insert(&xwm->surfaces, &surface->link);
 
 	wlr_signal_emit_safe(&xwm->xwayland->events.new_surface, surface);
@@ -386,6 +385,7 @@ static void xwayland_surface_destroy(
 		xwm_surface_activate(xsurface->xwm, NULL);
 	}
 
+	hash_table_remove(&xsurface->xwm->surfaces_by_id, xsurface->window_id);
 	wl_list_remove(&xsurface->link);
 	wl_list_remove(&xsurface->stack_link);
 	wl_list_remove(&xsurface->parent_link);
@@ -541,15 +541,19 @@ static void read_surface_parent(struct wlr_xwm *xwm,
 	wlr_signal_emit_safe(&xsurface->events.set_parent, xsurface);
 }
 
-static void read_surface_client_id(struct wlr_xwm *xwm,
-		struct wlr_xwayland_surface *xsurface) {
+static xcb_res_query_client_ids_cookie_t get_surface_client_id(
+		struct wlr_xwm *xwm, struct wlr_xwayland_surface *xsurface) {
 	xcb_res_client_id_spec_t spec = {
 		.client = xsurface->window_id,
 		.mask = XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID
 	};
 
-	xcb_res_query_client_ids_cookie_t cookie = xcb_res_query_client_ids(
-		xwm->xcb_conn, 1, &spec);
+	return xcb_res_query_client_ids(xwm->xcb_conn, 1, &spec);
+}
+
+static void read_surface_client_id(struct wlr_xwm *xwm,
+		struct wlr_xwayland_surface *xsurface,
+		xcb_res_query_client_ids_cookie_t cookie) {
 	xcb_res_query_client_ids_reply_t *reply = xcb_res_query_client_ids_reply(
 		xwm->xcb_conn, cookie,  NULL);
 	if (reply == NULL) {
@@ -758,10 +762,19 @@ char *xwm_get_atom_name(struct wlr_xwm *xwm, xcb_atom_t atom) {
 	return name;
 }
 
-static void read_surface_property(struct wlr_xwm *xwm,
+static xcb_get_property_cookie_t get_surface_property(struct wlr_xwm *xwm,
 		struct wlr_xwayland_surface *xsurface, xcb_atom_t property) {
-	xcb_get_property_cookie_t cookie = xcb_get_property(xwm->xcb_conn, 0,
-		xsurface->window_id, property, XCB_ATOM_ANY, 0, 2048);
+	return xcb_get_property(xwm->xcb_conn, 0, xsurface->window_id, property,
+		XCB_ATOM_ANY, 0, 2048);
+}
+
+/**
+ * Waits for the reply to a request sent with get_surface_property, and
+ * updates the surface accordingly.
+ */
+static void handle_surface_property(struct wlr_xwm *xwm,
+		struct wlr_xwayland_surface *xsurface, xcb_atom_t property,
+		xcb_get_property_cookie_t cookie) {
 	xcb_get_property_reply_t *reply = xcb_get_property_reply(xwm->xcb_conn,
 		cookie, NULL);
 	if (reply == NULL) {
@@ -801,6 +814,13 @@ static void read_surface_property(struct wlr_xwm *xwm,
 	free(reply);
 }
 
+static void read_surface_property(struct wlr_xwm *xwm,
+		struct wlr_xwayland_surface *xsurface, xcb_atom_t property) {
+	xcb_get_property_cookie_t cookie =
+		get_surface_property(xwm, xsurface, property);
+	handle_surface_property(xwm, xsurface, property, cookie);
+}
+
 static void xwayland_surface_role_commit(struct wlr_surface *wlr_surface) {
 	assert(wlr_surface->role == &xwayland_surface_role);
 	struct wlr_xwayland_surface *surface = wlr_surface->role_data;
@@ -868,13 +888,32 @@ static void xwm_map_shell_surface(struct wlr_xwm *xwm,
 		xwm->atoms[NET_WM_WINDOW_TYPE],
 		xwm->atoms[NET_WM_NAME],
 	};
-	for (size_t i = 0; i < sizeof(props)/sizeof(xcb_atom_t); i++) {
-		read_surface_property(xwm, xsurface, props[i]);
+	const size_t props_len = sizeof(props)/sizeof(xcb_atom_t);
+
+	// Send all requests before waiting for any reply, so that reading the
+	// properties only costs a single round trip to the X server
+	xcb_get_property_cookie_t cookies[sizeof(props)/sizeof(xcb_atom_t)];
+	for (size_t i = 0; i < props_len; i++) {
+		cookies[i] = get_surface_property(xwm, xsurface, props[i]);
+	}
+	size_t requests_len = props_len;
+	xcb_res_query_client_ids_cookie_t client_id_cookie = {0};
+	if (xwm->xres) {
+		client_id_cookie = get_surface_client_id(xwm, xsurface);
+		requests_len++;
+	}
+
+	for (size_t i = 0; i < props_len; i++) {
+		handle_surface_property(xwm, xsurface, props[i], cookies[i]);
 	}
 	if (xwm->xres) {
-		read_surface_client_id(xwm, xsurface);
+		read_surface_client_id(xwm, xsurface, client_id_cookie);
 	}
 
+	wlr_log(WLR_DEBUG, "Read %zu properties of window %" PRIu32
+		" with %zu requests sent before waiting for any reply",
+		props_len, xsurface->window_id, requests_len);
+
 	xsurface->surface_destroy.notify = handle_surface_destroy;
 	wl_signal_add(&surface->events.destroy, &xsurface->surface_destroy);
 }
@@ -1686,6 +1725,7 @@ void xwm_destroy(struct wlr_xwm *xwm) {
 	wl_list_for_each_safe(xsurface, tmp, &xwm->unpaired_surfaces, unpaired_link) {
 		xwayland_surface_destroy(xsurface);
 	}
+	hash_table_finish(&xwm->surfaces_by_id);
 	wl_list_remove(&xwm->compositor_new_surface.link);
 	wl_list_remove(&xwm->compositor_destroy.link);
 	xcb_disconnect(xwm->xcb_conn);
@@ -1930,6 +1970,7 @@ struct wlr_xwm *xwm_create(struct wlr_xwayland *xwayland, int wm_fd) {
 	wl_list_init(&xwm->surfaces);
 	wl_list_init(&xwm->surfaces_in_stack_order);
 	wl_list_init(&xwm->unpaired_surfaces);
+	hash_table_init(&xwm->surfaces_by_id);
 	xwm->ping_timeout = 10000;
 
 	xwm->xcb_conn = xcb_connect_to_fd(wm_fd, NULL);